@@ -33,13 +33,23 @@
 #include <cassert>
 #include <iostream>
 #include <stdexcept>
+#include <chrono>
 
 
 #include "basic_types.h"
 #include "binomial.h"
 #include "combinations.h"
+#include "prevision_table.h"
+#include "backtrace_table.h"
+#include "solver_context.h"
+#include "ordered_pool.h"
+#include "bit_kernels.h"
+#include "mask_batch.h"
 #include "new_columnreader.h"
 #include "blockreader.h"
+#include "wifb.h"
+#include "block_index.h"
+#include "alignment_reader.h"
 
 #ifdef LOAD_REVISION
 #include "revision.h"
@@ -75,12 +85,7 @@ bool check_end(ColumnReader1 &column_reader, const vector<Column> &input, const
   return (!column_reader.has_next() && (input[pointer][0].get_read_id() == -1));
 }
 
-static inline
-void complement_mask(BitColumn &mask, const Counter &length, const constants_t &constants)
-{
-  mask ^= (constants.ones<<length).flip();
-}
-
+template <typename BitColumn>
 static inline
 string column_to_string(const BitColumn &mask, const unsigned int &len) {
   string str = mask.to_string();
@@ -95,6 +100,146 @@ void replace_if_less(T& a, const T& b) {
   if(a > b) { a = b;}
 }
 
+//Frontier of the DP after a step, from which the following steps can be
+//computed again (in low-memory mode)
+struct dp_checkpoint_t {
+  Counter step;
+  vector<Column> input;
+  Pointer input_pointer;
+  vector<Counter> k_j;
+  vector<Counter> homo_cost;
+  vector<Cost> homo_weight;
+  PrevisionTable::snapshot_t prevision;
+  Pointer prevision_pointer;
+  vector<Cost> OPT;
+  Pointer OPT_pointer;
+  ColumnReader1::position_t reader;
+  //The backtrace of the step and of the MAX_L - 2 columns before it
+  BacktraceTable backtrace;
+};
+
+//Walk of reconstruct_haplotypes from the last column of the block to the
+//first one. It stops when it needs a column not held by the backtrace table.
+struct haplotype_walk_t {
+  Counter col;
+  bool in_block;
+  bool pending;
+  Backtrace1 back1;
+  bool back2_haplotypes;
+  bool back2_new_block;
+
+  haplotype_walk_t(const Counter &num_col)
+    : col(num_col - 1), in_block(false), pending(false),
+      back2_haplotypes(false), back2_new_block(false)
+  {}
+};
+
+//Data of a step of the DP shared by the ranges of the masks of column j
+struct dp_step_t {
+  Counter step;
+  const Column *column;
+  const vector<Counter> *no_gap_reads;
+  const vector<Counter> *gap_reads;
+  Counter cov_j;
+  Counter num_gaps;
+  Counter k;
+  Pointer first_projection;
+  Pointer indexer_pointer;
+  Pointer end_projection;
+  bool unweighted;
+  MaskBatch::relax_t relax;
+  //Third case of the recursion for D[j, C'j]
+  bool new_block;
+  Counter new_block_jump;
+  Cost new_block_homo;
+  const Cost *new_block_OPT;
+  const BacktraceTable *backtrace;
+  //Lower bound on D[j, C'j] minus the weight of C'j (the least finite
+  //lookup), and least weight of the masks of i reads without a gap
+  Cost lower_bound;
+  const Cost *min_weight;
+};
+
+//Correction masks of the columns solved by the DP: the ones generated (with
+//the ones among them whose lookups were pruned by the lower bound), and the
+//ones never generated since the lower bound rules them out; lookups of the
+//previous columns made by the masks, and the ones pruned by the lower bound
+struct mask_counters_t {
+  unsigned long long evaluated;
+  unsigned long long bounded;
+  unsigned long long skipped;
+  unsigned long long lookups;
+  unsigned long long bounded_lookups;
+
+  mask_counters_t()
+    : evaluated(0), bounded(0), skipped(0), lookups(0), bounded_lookups(0)
+  {}
+};
+
+//Column of a block without a feasible solution, reported by the main thread
+//(the blocks may be solved by other threads)
+struct infeasible_t {
+  bool found;
+  Counter block;
+  Counter step;
+  Counter coverage;
+  Counter k;
+
+  infeasible_t()
+    : found(false), block(0), step(0), coverage(0), k(0)
+  {}
+};
+
+//Haplotypes and counters of a sequence of consecutive blocks
+struct blocks_summary_t {
+  Counter step;
+  Cost OPT;
+  Counter counter_block;
+  Counter counter_columns;
+  Counter counter_inhomo;
+  Counter MAX_COV;
+  Counter MAX_L;
+  Counter MAX_K;
+  Counter MAX_GAPS;
+  Counter XS1;
+  Counter XS2;
+  Counter TOTAL_MISMATCHES;
+  mask_counters_t masks;
+  //The blocks after an infeasible one are not solved
+  infeasible_t infeasible;
+  vector<vector<char> > haplotype_blocks1;
+  vector<vector<char> > haplotype_blocks2;
+  //Number of columns solved by each call of dp, before and after splitting
+  //the blocks into connected components
+  vector<Counter> block_sizes;
+  vector<Counter> component_sizes;
+
+  blocks_summary_t()
+    : step(0), OPT(0), counter_block(0), counter_columns(0), counter_inhomo(0),
+      MAX_COV(0), MAX_L(0), MAX_K(0), MAX_GAPS(0), XS1(0), XS2(0), TOTAL_MISMATCHES(0)
+  {}
+};
+
+//Consecutive blocks solved by one of the threads (with --threads): a single
+//block, or a batch of tiny ones
+struct block_job_t {
+  vector<Counter> counter_blocks;
+  vector<shared_ptr<const Block> > blocks;
+  //Estimated cost of the blocks (see estimate_block_cost)
+  unsigned long long cost;
+  //Time taken to solve each block, in seconds
+  vector<double> seconds;
+  blocks_summary_t summary;
+
+  block_job_t()
+    : cost(0)
+  {}
+};
+
+//Cost of the blocks (estimated, in the units of estimate_block_cost) below
+//which they are batched into a single job
+static const unsigned long long TINY_BLOCK_COST = 10000;
+
 void fill_haplotypes(ColumnReader1 &columnreader, const vector<bool> &haplotype1, const vector<bool> &haplotype2,
                      vector<bool> &complete_haplo1, vector<bool> &complete_haplo2, const options_t &optionts);
 void fill_haplotypes(ColumnReader1 &columnreader, const vector<bool> &haplotype1, const vector<bool> &haplotype2,
@@ -102,27 +247,40 @@ void fill_haplotypes(ColumnReader1 &columnreader, const vector<bool> &haplotype1
 void write_haplotypes(const vector<vector<char> > &haplotype_blocks1, const vector<vector<char> > &haplotype_blocks2,
                       ofstream &ofs);
 
-void dp(const constants_t &constants, const options_t &options, ColumnReader1 &column_reader,
+void dp(const options_t &options, SolverContext &context, ColumnReader1 &column_reader,
         vector<bool> &haplotype1, vector<bool> &haplotype2, Counter &step_global, Cost &OPT_global,
         Counter &MAX_COV_global, Counter &MAX_L_global, Counter &MAX_K_global,
-        Counter &MAX_GAPS_global, const Counter &COUNTER_BLOCK);
+        Counter &MAX_GAPS_global, mask_counters_t &masks_global, infeasible_t &infeasible_global,
+        const Counter &COUNTER_BLOCK);
+void dp_single_column(const options_t &options, ColumnReader1 &column_reader,
+                      vector<bool> &haplotype1, vector<bool> &haplotype2, Counter &step_global,
+                      const Cost &OPT_global, Counter &MAX_COV_global, Counter &MAX_L_global,
+                      Counter &MAX_K_global, Counter &MAX_GAPS_global);
+bool dp_two_reads(const options_t &options, ColumnReader1 &column_reader,
+                  vector<bool> &haplotype1, vector<bool> &haplotype2, Counter &step_global,
+                  const Cost &OPT_global, Counter &MAX_COV_global, Counter &MAX_L_global,
+                  Counter &MAX_K_global, Counter &MAX_GAPS_global);
+template <typename BitColumn, typename Bits>
+void dp_kernel(const options_t &options, SolverContext &context, ColumnReader1 &column_reader,
+               vector<bool> &haplotype1, vector<bool> &haplotype2, Counter &step_global, Cost &OPT_global,
+               mask_counters_t &masks_global, infeasible_t &infeasible_global, const Counter &COUNTER_BLOCK,
+               const Counter &num_col, const Counter &MAX_COV, const Counter &MAX_L, const Counter &MAX_K);
 
 
 void computeInputParams(Counter &num_cols, Counter &MAX_COV, Counter &MAX_L,
-                        Counter &MAX_K, Counter &MAX_GAPS,vector<Counter> &sum_successive_L,
+                        Counter &MAX_K, Counter &MAX_GAPS, SolverContext &context,
                         ColumnReader1 &columnreader,
-                        vector<vector<Counter> > &scheme_backtrace,
                         const options_t &options);
+void measure_columns(ColumnReader1 &column_reader, Counter &MAX_COV, Counter &MAX_L,
+                     Counter &MAX_K, Counter &MAX_GAPS, unsigned long long &masks);
+template <typename BitColumn>
 void intersect(const Column &colQ, const Column &colJ, const Pointer &q,
                vector<vector<Pointer> > &forw_indexer, vector<vector<Pointer> > &back_indexer,
                vector<BitColumn> &pos_gaps, vector<Counter> &num_gaps, const bool &q_is_back);
+template <typename BitColumn>
 void represent_column(const Column &column, BitColumn &result, Counter &cov,
                       BitColumn &gaps_mask, Counter &num_gaps);
-void make_mask(BitColumn &mask, const BitColumn &mask_gaps, const unsigned int &cov,
-               const BitColumn &comb_gaps, const BitColumn &comb_no_gaps);
-unsigned int compute_index_of(const BitColumn &mask, const unsigned int &cov, const unsigned int &num_gaps,
-                              const BitColumn &pos_gaps, Combinations &generator);
-void cut(const BitColumn &in_col, BitColumn &cut_mask, const vector<Pointer> &indexer, Counter &active_pj);
+template <typename BitColumn>
 void extract_common_mask(const Column &column_q, const Pointer &q_pointer,
                          const Column &column_j, const BitColumn &mask_colj,
                          const vector<vector<Pointer> > &back_indexer,
@@ -132,10 +290,63 @@ int compute_active_common(const Column &colJ, const Column &colQ, unsigned int &
 void insert_col_and_update(vector<Column> &input, vector<Counter> &k_j, vector <Counter> &homo_cost,
                            vector<Cost> &homo_weight, const Pointer &pointer, const Column &column, const options_t &options,
                            vector<bool> &kind_homozygous, const Counter &step);
-void compute_weight_mask(const BitColumn &mask, const Column &column, Cost &weight_mask);
-void reconstruct_haplotypes(const vector<vector<vector<Backtrace1> > > &backtrace_table1,
-                            const vector<vector<vector<bool> > > &backtrace_table2_haplotypes,
-                            const vector<vector<vector<bool> > > &backtrace_table2_new_block,
+template <typename BitColumn, typename Bits>
+void flip_read(const Counter &read, BitColumn &mask, Cost::cost_t &weight, const Column &column,
+               vector<MaskProjection<BitColumn> > &projections,
+               const Pointer &first, const Pointer &j, const Pointer &end);
+
+template <typename BitColumn, typename Bits>
+void evaluate_masks(const dp_step_t &data, MaskRange<BitColumn> &range,
+                    vector<MaskProjection<BitColumn> > &projections, MaskBatch &batch,
+                    BacktraceTable *backtrace_table);
+
+//The ranges of the masks of a column, evaluated by the threads of the DP:
+//each of them starts from the projections of the empty mask and from the
+//neighbours of j, and keeps its previsions
+template <typename BitColumn, typename Bits>
+struct dp_ranges_task_t : public WorkerPool::task_t {
+  const dp_step_t &data;
+  vector<MaskRange<BitColumn> > &ranges;
+  const unsigned int parts;
+  const vector<MaskProjection<BitColumn> > &projections;
+  const MaskBatch &batch;
+
+  dp_ranges_task_t(const dp_step_t &data, vector<MaskRange<BitColumn> > &ranges,
+                   const unsigned int parts, const vector<MaskProjection<BitColumn> > &projections,
+                   const MaskBatch &batch)
+    : data(data), ranges(ranges), parts(parts), projections(projections), batch(batch)
+  {}
+
+  void run(const unsigned int part) {
+    if(part >= parts) {
+      return;
+    }
+    MaskRange<BitColumn> &range = ranges[part];
+    range.projections = projections;
+    range.batch.previous = batch.previous;
+    range.batch.successive = batch.successive;
+    range.batch.reset_lanes();
+    evaluate_masks<BitColumn, Bits>(data, range, range.projections, range.batch, NULL);
+  }
+};
+Counter segment_length(const Counter &num_col, const size_t &checkpoint_memory,
+                       const vector<vector<Counter> > &scheme_backtrace,
+                       const unsigned int &entry_bits);
+void save_checkpoint(dp_checkpoint_t &checkpoint, const Counter &step,
+                     const vector<Column> &input, const Pointer &input_pointer,
+                     const vector<Counter> &k_j, const vector<Counter> &homo_cost,
+                     const vector<Cost> &homo_weight, const PrevisionTable &prevision,
+                     const Pointer &prevision_pointer, const vector<Cost> &OPT, const Pointer &OPT_pointer,
+                     const ColumnReader1 &column_reader, const BacktraceTable &backtrace_table,
+                     const vector<vector<Counter> > &scheme_backtrace, const Counter &MAX_L);
+void restore_checkpoint(const dp_checkpoint_t &checkpoint, Counter &step,
+                        vector<Column> &input, Pointer &input_pointer,
+                        vector<Counter> &k_j, vector<Counter> &homo_cost,
+                        vector<Cost> &homo_weight, PrevisionTable &prevision,
+                        Pointer &prevision_pointer, vector<Cost> &OPT, Pointer &OPT_pointer,
+                        ColumnReader1 &column_reader);
+void reconstruct_haplotypes(const BacktraceTable &backtrace_table,
+                            haplotype_walk_t &walk,
                             const vector<bool> &is_homozygous,
                             const vector<bool> &homo_haplotypes,
                             const vector<Backtrace1> &best_heterozygous1,
@@ -147,17 +358,101 @@ void add_xs(const vector<bool> &haplo1, const vector<bool> &haplo2,
             vector<char> &haplo1_out, vector<char> &haplo2_out,
             ColumnReader1 &column_reader, const options_t &options,
             Counter &XS1, Counter &XS2, Counter &MISMATCHES);
-int map_fragment(const vector<char> &read, const vector<unsigned int> &weights, const unsigned int offset,
-                 const vector<bool> &haplo1_in, const vector<bool> &haplo2_in, unsigned int &total_errors);
-void make_haplo(const vector<bool> &haplo1, const vector<bool> &haplo2,
-                const vector<vector<char> > &mapping_haplo1, const vector<vector<char> > &mapping_haplo2,
-                const vector<vector<unsigned int> > &weight_mapping_haplo1, const vector<vector<unsigned int> > &weight_mapping_haplo2,
-                vector<char> &haplo_out1, vector<char> &haplo_out2, Counter &XS1, Counter &XS2,
+int map_fragment(const unsigned int distance1, const unsigned int distance2, unsigned int &total_errors);
+void make_haplo(const bool haplo1, const bool haplo2, const vector<int> &counter1, const vector<int> &counter2,
+                char &haplo_out1, char &haplo_out2, Counter &count_X1, Counter &count_X2,
                 const options_t &options);
-void count_alleles(const vector<char> &col, const vector<unsigned int> &weight_col,
-                   vector<int> &counter);
+void benchmark_parsing(const options_t &options);
+void benchmark_ranking();
+void load_alignments(const options_t &options, FragmentSet &fragments);
+void split_components(ColumnReader1 &columnreader, vector<Block> &components,
+                      vector<vector<Counter> > &component_columns);
+void report_block_sizes(const string &name, const vector<Counter> &sizes);
+void solve_block(const options_t &options, SolverContext &context, BlockReader *stream,
+                 const Block *block, const Counter &counter_block, blocks_summary_t &summary);
+void append_summary(blocks_summary_t &summary, blocks_summary_t &next);
+unsigned long long estimate_block_cost(const options_t &options, const Block &block);
+double list_makespan(const vector<double> &durations, const unsigned int &threads);
+
+//The threads that solve the blocks, each one with its working memory
+struct block_solver_t : public OrderedPool<block_job_t>::solver_t {
+  const options_t &options;
+  vector<SolverContext> &contexts;
+
+  block_solver_t(const options_t &options, vector<SolverContext> &contexts)
+    : options(options), contexts(contexts)
+  {}
+
+  void solve(block_job_t &job, const unsigned int thread) {
+    job.seconds.resize(job.blocks.size());
+    for(size_t i = 0; i < job.blocks.size(); ++i) {
+      const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      solve_block(options, contexts[thread], NULL, job.blocks[i].get(), job.counter_blocks[i], job.summary);
+      const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+      job.seconds[i] = elapsed.count();
+      job.blocks[i].reset();
+      if(job.summary.infeasible.found) {
+        break;
+      }
+    }
+  }
+};
+
+
+
+
 
+//Report the block without a feasible solution and exit, from the main thread
+//(the threads of the pool, if any, are stopped first)
+static void exit_infeasible(const options_t &options, const infeasible_t &infeasible,
+                            OrderedPool<block_job_t> *pool)
+{
+  INFO("*** NO SOLUTION FOR BLOCK: " << infeasible.block);
+  INFO("<<>> No feasible solution exist with these parameters -- alpha = " << options.alpha << " and error rate = " << options.error_rate);
+  INFO("<<>> The last not feasible column is:  " << infeasible.step << "  with coverage = " << infeasible.coverage << " and k = " << infeasible.k);
+  if(pool != NULL) {
+    pool->cancel();
+  }
+  exit(EXIT_FAILURE);
+}
+
+//Append the blocks of the solved job to summary, and keep its times (exit if
+//one of its blocks has no solution)
+static void collect_job(const options_t &options, OrderedPool<block_job_t> &pool, block_job_t &job,
+                        blocks_summary_t &summary, vector<double> &block_seconds,
+                        vector<double> &job_seconds, vector<unsigned long long> &job_costs)
+{
+  if(job.summary.infeasible.found) {
+    exit_infeasible(options, job.summary.infeasible, &pool);
+  }
+  append_summary(summary, job.summary);
+  block_seconds.insert(block_seconds.end(), job.seconds.begin(), job.seconds.end());
+  double seconds = 0.0;
+  for(size_t i = 0; i < job.seconds.size(); ++i) {
+    seconds += job.seconds[i];
+  }
+  job_seconds.push_back(seconds);
+  job_costs.push_back(job.cost);
+}
 
+//Submit the job to the pool (collecting the oldest jobs while it is full)
+static void submit_job(const options_t &options, OrderedPool<block_job_t> &pool, unique_ptr<block_job_t> &job,
+                       blocks_summary_t &summary, vector<double> &block_seconds,
+                       vector<double> &job_seconds, vector<unsigned long long> &job_costs)
+{
+  while(pool.full()) {
+    unique_ptr<block_job_t> solved(pool.collect());
+    collect_job(options, pool, *solved, summary, block_seconds, job_seconds, job_costs);
+  }
+  const unsigned long long cost = job->cost;
+  pool.submit(job.release(), cost);
+}
+
+static bool greater_cost(const pair<unsigned long long, size_t> &a,
+                         const pair<unsigned long long, size_t> &b)
+{
+  return a.first > b.first;
+}
 
 
 
@@ -170,19 +465,33 @@ int main(int argc, char** argv)
 #endif
   INFO("Starting...");
 
-  Counter threshold_coverage = 30;
-
-  const constants_t constants;
-
   const options_t options= parse_arguments(argc, argv);
   INFO("Arguments:");
   INFO("Initialized? " << (options.options_initialized?"True":"False"));
   INFO("Input filename: '" << options.input_filename << '\'');
   INFO("Haplotype filename: '" << options.haplotype_filename << '\'');
+  INFO("Binary conversion filename: '" << options.convert_filename << '\'');
+  INFO("Alignment filename: '" << options.alignment_filename << '\'');
+  INFO("Variant filename: '" << options.variant_filename << '\'');
+  INFO("Chromosome: '" << options.chromosome << '\'');
+  INFO("Minimum base quality: " << options.min_base_quality);
+  INFO("Minimum read quality: " << options.min_read_quality);
   INFO("Discard weights? " << (options.unweighted?"True":"False"));
   INFO("Do not add X's? " << (options.no_xs?"True":"False"));
   INFO("All-heterozygous assumption? " << (options.all_heterozygous?"True":"False"));
   INFO("Input as unique block? " << (options.unique?"True":"False"));
+  INFO("Parse only? " << (options.parse_only?"True":"False"));
+  INFO("Ranking benchmark? " << (options.benchmark_ranking?"True":"False"));
+  INFO("Parsing threads: " << options.parse_threads);
+  INFO("DP threads: " << options.dp_threads);
+  INFO("Block threads: " << options.threads);
+  INFO("Low-memory DP? " << (options.low_memory?"True":"False"));
+  if(options.region) {
+    INFO("Region: " << options.region_start << '-' << options.region_end);
+  } else {
+    INFO("Region: none");
+  }
+  INFO("Maximum coverage: " << options.max_coverage);
   INFO("Error rate: " << options.error_rate);
   INFO("Alpha: " << options.alpha);
 
@@ -191,117 +500,396 @@ int main(int argc, char** argv)
     exit(EXIT_FAILURE);
   }
 
+  if (options.parse_only) {
+    benchmark_parsing(options);
+    return EXIT_SUCCESS;
+  }
+
+  if (options.benchmark_ranking) {
+    binom_coeff::initialize_binomial_coefficients(MAX_COVERAGE, MAX_COVERAGE);
+    benchmark_ranking();
+    return EXIT_SUCCESS;
+  }
+
+  if (!options.convert_filename.empty()) {
+    INFO("Converting '" << (options.alignment_filename.empty() ? options.input_filename : options.alignment_filename)
+         << "' into the binary file '" << options.convert_filename << "'...");
+    //The weights are always stored (--discard-weights is applied while loading)
+    FragmentSet fragments;
+    unique_ptr<BlockReader> reader;
+    if(options.alignment_filename.empty()) {
+      reader.reset(new BlockReader(options.input_filename, MAX_COUNTER, false, false,
+                                   options.parse_threads));
+    } else {
+      load_alignments(options, fragments);
+      reader.reset(new BlockReader(fragments, MAX_COUNTER, false, false));
+    }
+    convert_to_wifb(*reader, options.convert_filename);
+    INFO("Conversion completed");
+    return EXIT_SUCCESS;
+  }
+
   //Initializing the starting parameters: no competitive section
 
+  if(use_bmi2()) {
+    INFO("Gather kernel of the DP: BMI2");
+  } else if(has_bmi2()) {
+    INFO("Gather kernel of the DP: portable (the pext of BMI2 is microcoded on this AMD CPU)");
+  } else {
+    INFO("Gather kernel of the DP: portable (the CPU does not support BMI2)");
+  }
+  INFO("Batch kernel of the DP: " << MaskBatch::relax_kernel_name());
+
   //Pre-compute binomial values
   binom_coeff::initialize_binomial_coefficients(MAX_COVERAGE, MAX_COVERAGE);
   computeK(MAX_COVERAGE, options.alpha, options.error_rate);
 
-  Counter step = 0;
-  Cost OPT = 0;
+  //The fragments of an alignment file are built in memory
+  FragmentSet alignment_fragments;
+  unique_ptr<BlockReader> reader;
+  if(options.alignment_filename.empty()) {
+    reader.reset(new BlockReader(options.input_filename, options.max_coverage, options.unweighted,
+                                 options.unique, options.parse_threads));
+  } else {
+    load_alignments(options, alignment_fragments);
+    reader.reset(new BlockReader(alignment_fragments, options.max_coverage, options.unweighted,
+                                 options.unique));
+  }
+  BlockReader &blockreader = *reader;
+
+  blocks_summary_t summary;
+
+  //Working memory of the DP of each thread, kept from a block to the
+  //following ones
+  vector<SolverContext> contexts(options.threads);
+
+  //With more threads the blocks are solved concurrently (the unique block
+  //is read while it is solved, hence it is solved by the main thread), and
+  //they are collected in their order. The costliest blocks among the ones
+  //read ahead are started first, and the tiny ones are solved in batches.
+  block_solver_t solver(options, contexts);
+  unique_ptr<OrderedPool<block_job_t> > pool;
+  if(options.threads > 1 && !blockreader.is_streaming()) {
+    pool.reset(new OrderedPool<block_job_t>(options.threads, 64 * options.threads, solver));
+  }
+  unique_ptr<block_job_t> batch;
+  //Solution time of the blocks and of the jobs, and estimated cost of the
+  //jobs, in their order
+  vector<double> block_seconds;
+  vector<double> job_seconds;
+  vector<unsigned long long> job_costs;
+  const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  //With a region, the reader is moved straight to the first block overlapping it
+  bool empty_region = false;
+  if(options.region) {
+    if(!blockreader.is_indexable()) {
+      INFO("The input cannot be indexed: all its blocks will be read");
+    } else {
+      BlockIndex index;
+      if(!index.read(options.input_filename)) {
+        INFO("Building the block index '" << BlockIndex::filename(options.input_filename) << "'...");
+        index.build(options.input_filename, options.parse_threads);
+        if(!index.write(options.input_filename)) {
+          INFO("The block index cannot be written: it will be built again by the next run");
+        }
+      }
+
+      size_t first_block = 0;
+      size_t last_block = 0;
+      index.overlapping(options.region_start, options.region_end, first_block, last_block);
+      INFO("Blocks overlapping the region: " << (last_block - first_block)
+           << " of " << index.get_blocks().size());
+      if(first_block < last_block) {
+        blockreader.seek_block(index.get_blocks()[first_block].offset);
+      } else {
+        empty_region = true;
+      }
+    }
+  }
+
   Counter counter_block = 0;
-  Counter counter_columns = 0;
-  Counter counter_inhomo = 0;
-  BlockReader blockreader(options.input_filename, threshold_coverage, options.unweighted, options.unique);
+  while(!empty_region && blockreader.has_next()) {
+    if(options.region) {
+      const vector<Pointer> &positions = blockreader.get_block_positions();
+      if(positions.empty() || positions.back() < options.region_start) {
+        continue;
+      }
+      if(positions.front() > options.region_end) {
+        break;
+      }
+    }
 
-  Counter MAX_COV = 0;
-  Counter MAX_L = 0;
-  Counter MAX_K = 0;
-  Counter MAX_GAPS = 0;
-  Counter XS1 = 0;
-  Counter XS2 = 0;
-  Counter TOTAL_MISMATCHES = 0;
+    if(!pool) {
+      if(blockreader.is_streaming()) {
+        solve_block(options, contexts[0], &blockreader, NULL, counter_block, summary);
+      } else {
+        const shared_ptr<const Block> block = blockreader.get_block();
+        solve_block(options, contexts[0], NULL, block.get(), counter_block, summary);
+      }
+      if(summary.infeasible.found) {
+        exit_infeasible(options, summary.infeasible, NULL);
+      }
+    } else {
+      //A block that is not tiny ends the current batch
+      const shared_ptr<const Block> block = blockreader.get_block();
+      const unsigned long long cost = estimate_block_cost(options, *block);
+      if(batch && cost >= TINY_BLOCK_COST) {
+        submit_job(options, *pool, batch, summary, block_seconds, job_seconds, job_costs);
+      }
+      if(!batch) {
+        batch.reset(new block_job_t());
+      }
+      batch->counter_blocks.push_back(counter_block);
+      batch->blocks.push_back(block);
+      batch->cost += cost;
+      if(batch->cost >= TINY_BLOCK_COST) {
+        submit_job(options, *pool, batch, summary, block_seconds, job_seconds, job_costs);
+      }
+    }
+    ++counter_block;
+  }
+  if(pool) {
+    if(batch) {
+      submit_job(options, *pool, batch, summary, block_seconds, job_seconds, job_costs);
+    }
+    for(unique_ptr<block_job_t> job(pool->collect()); job; job.reset(pool->collect())) {
+      collect_job(options, *pool, *job, summary, block_seconds, job_seconds, job_costs);
+    }
+  }
+  const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
 
-  vector<vector<char> > haplotype_blocks1;
-  vector<vector<char> > haplotype_blocks2;
+  INFO("");
 
-  while(blockreader.has_next()) {
-    Block block = blockreader.get_block();
-    DEBUG("BLOCK: "<< counter_block);
+  INFO("OPTIMUM:  " << summary.OPT);
 
-    ColumnReader1 columnreader_jump(block, !options.all_heterozygous);
+  INFO("");
 
-    vector<bool> haplotype1(columnreader_jump.num_cols());
-    vector<bool> haplotype2(columnreader_jump.num_cols());
+  INFO("MAX_COV:  " << summary.MAX_COV);
+  INFO("MAX_L:  " << summary.MAX_L);
+  INFO("MAX_K:  " << summary.MAX_K);
+  INFO("MAX_GAPS:  " << summary.MAX_GAPS);
+  INFO("# of blocks:  " << summary.counter_block);
+  INFO("# of independent components:  " << summary.component_sizes.size());
+  INFO("# of columns:  "  << summary.counter_columns);
+  INFO("# of reads discarded by the coverage cap:  " << blockreader.get_discarded_fragments());
+  INFO("# of homozygous in input:  " << summary.counter_inhomo);
+  INFO("# of correction masks:  " << summary.masks.evaluated + summary.masks.skipped
+       << "  (pruned by the lower bound: " << summary.masks.bounded + summary.masks.skipped
+       << ", of which never generated: " << summary.masks.skipped << ")");
+  INFO("# of lookups of the masks:  " << summary.masks.lookups
+       << "  (pruned by the lower bound: " << summary.masks.bounded_lookups << ")");
 
-    if(columnreader_jump.num_cols() > 0) {
-      dp(constants, options, columnreader_jump, haplotype1, haplotype2, step, OPT,
-         MAX_COV, MAX_L, MAX_K, MAX_GAPS, counter_block++);
-    } else {
-      DEBUG("jumped");
-      ++counter_block;
-    }
+  INFO("");
 
-    ColumnReader1 columnreader_nojump(block, false);
+  report_block_sizes("blocks", summary.block_sizes);
+  report_block_sizes("components", summary.component_sizes);
+
+  INFO("");
+
+  INFO("X's INSERTED IN THE FIRST HAPLOTYPE:  " << summary.XS1);
+  INFO("X's INSERTED IN THE SECOND HAPLOTYPE:  " << summary.XS2);
+  INFO("TOTAL MISMATCHES:  " << summary.TOTAL_MISMATCHES);
+
+  if(pool) {
+    //The makespans of the blocks in the order of the input and of the jobs
+    //in decreasing estimated cost (as if all of them were read in advance),
+    //from the times measured by this run
+    vector<pair<unsigned long long, size_t> > by_cost;
+    for(size_t i = 0; i < job_costs.size(); ++i) {
+      by_cost.push_back(make_pair(job_costs[i], i));
+    }
+    stable_sort(by_cost.begin(), by_cost.end(), greater_cost);
+    vector<double> largest_first;
+    for(size_t i = 0; i < by_cost.size(); ++i) {
+      largest_first.push_back(job_seconds[by_cost[i].second]);
+    }
+    double total = 0.0;
+    for(size_t i = 0; i < block_seconds.size(); ++i) {
+      total += block_seconds[i];
+    }
 
-    counter_columns += columnreader_nojump.num_cols();
-    counter_inhomo += (columnreader_nojump.num_cols() - columnreader_jump.num_cols());
+    INFO("");
+    INFO("Blocks solved by " << options.threads << " threads in " << elapsed.count() << " s ("
+         << job_seconds.size() << " jobs, " << pool->stolen() << " stolen)");
+    INFO("Time taken by the blocks:  " << total << " s");
+    INFO("Makespan of the blocks (from their times):  " << list_makespan(largest_first, options.threads)
+         << " s largest first, " << list_makespan(block_seconds, options.threads) << " s FIFO");
+  }
 
-    if(!options.no_xs) {
-      vector<bool> filled_haplo1(columnreader_nojump.num_cols());
-      vector<bool> filled_haplo2(columnreader_nojump.num_cols());
+  DEBUG("<<>> Writing haplotypes...");
+  ofstream ofs;
+  try {
+    ofs.open(options.haplotype_filename.c_str(), ios::out);
+    write_haplotypes(summary.haplotype_blocks1, summary.haplotype_blocks2, ofs);
+  } catch(exception & e) {
+    ERROR("::::::: Error writing haplotype to \"" << options.haplotype_filename << "\": " << e.what());
+    //write_haplotypes(haplotype_blocks1, haplotype_blocks2, cout);
+    return EXIT_FAILURE;
+  }
+}
 
-      DEBUG("Starting fill");
 
-      fill_haplotypes(columnreader_nojump, haplotype1, haplotype2, filled_haplo1, filled_haplo2, options);
 
-      DEBUG("Filled haplotypes");
+//Solve the block (read from stream in unique mode) and add its haplotypes
+//and its counters to summary
+void solve_block(const options_t &options, SolverContext &context, BlockReader *stream,
+                 const Block *block, const Counter &counter_block, blocks_summary_t &summary)
+{
+  DEBUG("BLOCK: "<< counter_block);
 
-      vector<char> xs_haplotype1(columnreader_nojump.num_cols());
-      vector<char> xs_haplotype2(columnreader_nojump.num_cols());
+  //The columns left without entries by the read selection have no cost
+  ColumnReader1 columnreader_jump = (stream != NULL)
+    ? ColumnReader1(*stream, !options.all_heterozygous, true)
+    : ColumnReader1(*block, !options.all_heterozygous, true);
 
-      add_xs(filled_haplo1, filled_haplo2, xs_haplotype1, xs_haplotype2, columnreader_nojump, options,
-             XS1, XS2, TOTAL_MISMATCHES);
+  vector<bool> haplotype1(columnreader_jump.num_cols());
+  vector<bool> haplotype2(columnreader_jump.num_cols());
 
-      DEBUG("Added X's");
+  if(columnreader_jump.num_cols() > 0) {
+    summary.block_sizes.push_back(columnreader_jump.num_cols());
 
-      haplotype_blocks1.push_back(xs_haplotype1);
-      haplotype_blocks2.push_back(xs_haplotype2);
+    //The unique block is not kept in memory, hence it is not split
+    vector<Block> components;
+    vector<vector<Counter> > component_columns;
+    if(stream == NULL) {
+      split_components(columnreader_jump, components, component_columns);
+    }
 
+    if(components.size() <= 1) {
+      summary.component_sizes.push_back(columnreader_jump.num_cols());
+      dp(options, context, columnreader_jump, haplotype1, haplotype2, summary.step, summary.OPT,
+         summary.MAX_COV, summary.MAX_L, summary.MAX_K, summary.MAX_GAPS, summary.masks,
+         summary.infeasible, counter_block);
     } else {
-      vector<char> output_block1(columnreader_nojump.num_cols());
-      vector<char> output_block2(columnreader_nojump.num_cols());
+      DEBUG("Block split into " << components.size() << " components");
+      for(size_t c = 0; c < components.size(); ++c) {
+        ColumnReader1 columnreader_component(components[c], false);
+        vector<bool> component_haplotype1(columnreader_component.num_cols());
+        vector<bool> component_haplotype2(columnreader_component.num_cols());
+
+        summary.component_sizes.push_back(columnreader_component.num_cols());
+        dp(options, context, columnreader_component, component_haplotype1, component_haplotype2,
+           summary.step, summary.OPT, summary.MAX_COV, summary.MAX_L, summary.MAX_K, summary.MAX_GAPS,
+           summary.masks, summary.infeasible, counter_block);
+        if(summary.infeasible.found) {
+          return;
+        }
 
-      fill_haplotypes(columnreader_nojump, haplotype1, haplotype2, output_block1, output_block2, options);
+        //The relative phase of the components is arbitrary, hence it can
+        //differ from the one of the DP of the whole block (at equal cost)
+        for(size_t i = 0; i < component_columns[c].size(); ++i) {
+          haplotype1[component_columns[c][i]] = component_haplotype1[i];
+          haplotype2[component_columns[c][i]] = component_haplotype2[i];
+        }
+      }
+    }
+  } else {
+    DEBUG("jumped");
+  }
+  //The main thread reports the block without solution and exits
+  if(summary.infeasible.found) {
+    return;
+  }
+  ++summary.counter_block;
 
-      DEBUG("Filled haplotypes");
+  ColumnReader1 columnreader_nojump = (stream != NULL)
+    ? ColumnReader1(*stream, false)
+    : ColumnReader1(*block, false);
 
-      haplotype_blocks1.push_back(output_block1);
-      haplotype_blocks2.push_back(output_block2);
-    }
+  summary.counter_columns += columnreader_nojump.num_cols();
+  summary.counter_inhomo += (columnreader_nojump.num_cols() - columnreader_jump.num_cols());
+
+  summary.haplotype_blocks1.push_back(vector<char>(columnreader_nojump.num_cols()));
+  summary.haplotype_blocks2.push_back(vector<char>(columnreader_nojump.num_cols()));
 
+  if(!options.no_xs) {
+    vector<bool> filled_haplo1(columnreader_nojump.num_cols());
+    vector<bool> filled_haplo2(columnreader_nojump.num_cols());
+
+    DEBUG("Starting fill");
+
+    fill_haplotypes(columnreader_nojump, haplotype1, haplotype2, filled_haplo1, filled_haplo2, options);
+
+    DEBUG("Filled haplotypes");
+
+    add_xs(filled_haplo1, filled_haplo2, summary.haplotype_blocks1.back(), summary.haplotype_blocks2.back(),
+           columnreader_nojump, options, summary.XS1, summary.XS2, summary.TOTAL_MISMATCHES);
+
+    DEBUG("Added X's");
+
+  } else {
+    fill_haplotypes(columnreader_nojump, haplotype1, haplotype2,
+                    summary.haplotype_blocks1.back(), summary.haplotype_blocks2.back(), options);
+
+    DEBUG("Filled haplotypes");
   }
+}
 
-  INFO("");
 
-  INFO("OPTIMUM:  " << OPT);
 
-  INFO("");
+//Append the blocks of next to the ones of summary (next is left empty)
+void append_summary(blocks_summary_t &summary, blocks_summary_t &next)
+{
+  summary.step += next.step;
+  summary.OPT += next.OPT;
+  summary.counter_block += next.counter_block;
+  summary.counter_columns += next.counter_columns;
+  summary.counter_inhomo += next.counter_inhomo;
+  summary.MAX_COV = max(summary.MAX_COV, next.MAX_COV);
+  summary.MAX_L = max(summary.MAX_L, next.MAX_L);
+  summary.MAX_K = max(summary.MAX_K, next.MAX_K);
+  summary.MAX_GAPS = max(summary.MAX_GAPS, next.MAX_GAPS);
+  summary.XS1 += next.XS1;
+  summary.XS2 += next.XS2;
+  summary.TOTAL_MISMATCHES += next.TOTAL_MISMATCHES;
+  summary.masks.evaluated += next.masks.evaluated;
+  summary.masks.bounded += next.masks.bounded;
+  summary.masks.skipped += next.masks.skipped;
+  summary.masks.lookups += next.masks.lookups;
+  summary.masks.bounded_lookups += next.masks.bounded_lookups;
+  for(size_t i = 0; i < next.haplotype_blocks1.size(); ++i) {
+    summary.haplotype_blocks1.push_back(vector<char>());
+    summary.haplotype_blocks1.back().swap(next.haplotype_blocks1[i]);
+    summary.haplotype_blocks2.push_back(vector<char>());
+    summary.haplotype_blocks2.back().swap(next.haplotype_blocks2[i]);
+  }
+  summary.block_sizes.insert(summary.block_sizes.end(), next.block_sizes.begin(), next.block_sizes.end());
+  summary.component_sizes.insert(summary.component_sizes.end(),
+                                 next.component_sizes.begin(), next.component_sizes.end());
+  next = blocks_summary_t();
+}
 
-  INFO("MAX_COV:  " << MAX_COV);
-  INFO("MAX_L:  " << MAX_L);
-  INFO("MAX_K:  " << MAX_K);
-  INFO("MAX_GAPS:  " << MAX_GAPS);
-  INFO("# of blocks:  " << counter_block);
-  INFO("# of columns:  "  << counter_columns);
-  INFO("# of homozygous in input:  " << counter_inhomo);
 
-  INFO("");
 
-  INFO("X's INSERTED IN THE FIRST HAPLOTYPE:  " << XS1);
-  INFO("X's INSERTED IN THE SECOND HAPLOTYPE:  " << XS2);
-  INFO("TOTAL MISMATCHES:  " << TOTAL_MISMATCHES);
+//Estimated cost of solving the block, in units of a few nanoseconds: each
+//mask of a column is evaluated against the columns of its window (less than
+//MAX_L on each side), a column costs about as much as one of its masks, and
+//the setup of a block about as much as a thousand masks.
+unsigned long long estimate_block_cost(const options_t &options, const Block &block)
+{
+  ColumnReader1 column_reader(block, !options.all_heterozygous, true);
+  Counter MAX_COV = 0;
+  Counter MAX_L = 0;
+  Counter MAX_K = 0;
+  Counter MAX_GAPS = 0;
+  unsigned long long masks = 0;
+  measure_columns(column_reader, MAX_COV, MAX_L, MAX_K, MAX_GAPS, masks);
+  return (masks + column_reader.num_cols()) * MAX_L + 1000;
+}
+
 
-  DEBUG("<<>> Writing haplotypes...");
-  ofstream ofs;
-  try {
-    ofs.open(options.haplotype_filename.c_str(), ios::out);
-    write_haplotypes(haplotype_blocks1, haplotype_blocks2, ofs);
-  } catch(exception & e) {
-    ERROR("::::::: Error writing haplotype to \"" << options.haplotype_filename << "\": " << e.what());
-    //write_haplotypes(haplotype_blocks1, haplotype_blocks2, cout);
-    return EXIT_FAILURE;
+
+//Makespan of tasks of the given durations on threads threads, each task
+//taken in order by the first thread that is idle
+double list_makespan(const vector<double> &durations, const unsigned int &threads)
+{
+  vector<double> idle(threads, 0.0);
+  for(size_t i = 0; i < durations.size(); ++i) {
+    vector<double>::iterator first = min_element(idle.begin(), idle.end());
+    *first += durations[i];
   }
+  return *max_element(idle.begin(), idle.end());
 }
 
 
@@ -318,7 +906,7 @@ void fill_haplotypes(ColumnReader1 &columnreader, const vector<bool> &haplotype1
   vector<bool>::iterator iout2 = complete_haplo2.begin();
 
   while(columnreader.has_next()) {
-    if(!options.all_heterozygous && columnreader.was_homozygous()) {
+    if((!options.all_heterozygous && columnreader.was_homozygous()) || columnreader.was_uncovered()) {
       bool allele = (columnreader.homozigosity())? true : false;
       *iout1 = allele;
       *iout2 = allele;
@@ -347,7 +935,7 @@ void fill_haplotypes(ColumnReader1 &columnreader, const vector<bool> &haplotype1
   vector<char>::iterator iout2 = output_block2.begin();
 
   while(columnreader.has_next()) {
-    if(!options.all_heterozygous && columnreader.was_homozygous()) {
+    if((!options.all_heterozygous && columnreader.was_homozygous()) || columnreader.was_uncovered()) {
       char allele = (columnreader.homozigosity())? '1' : '0';
       *iout1 = allele;
       *iout2 = allele;
@@ -368,6 +956,12 @@ void fill_haplotypes(ColumnReader1 &columnreader, const vector<bool> &haplotype1
 void write_haplotypes(const vector<vector<char> > &haplotype_blocks1, const vector<vector<char> > &haplotype_blocks2,
                       ofstream &ofs)
 {
+  //No block has been solved (e.g., no block overlaps the region)
+  if(haplotype_blocks1.empty()) {
+    ofs << endl << endl;
+    return;
+  }
+
   vector<vector<char> >::const_iterator ivv = haplotype_blocks1.begin();
   ofs << *ivv;
   for(ivv = haplotype_blocks1.begin() + 1;
@@ -389,21 +983,35 @@ void write_haplotypes(const vector<vector<char> > &haplotype_blocks1, const vect
 
 
 
-void dp(const constants_t &constants, const options_t &options, ColumnReader1 &column_reader,
+//The DP is run by the kernel on the narrowest bitsets that hold the
+//coverage of the block (the blocks of a single column or of coverage 2 do
+//not need it)
+void dp(const options_t &options, SolverContext &context, ColumnReader1 &column_reader,
         vector<bool> &haplotype1, vector<bool> &haplotype2, Counter &step_global, Cost &OPT_global,
         Counter &MAX_COV_global, Counter &MAX_L_global, Counter &MAX_K_global,
-        Counter &MAX_GAPS_global, const Counter &COUNTER_BLOCK)
+        Counter &MAX_GAPS_global, mask_counters_t &masks_global, infeasible_t &infeasible_global,
+        const Counter &COUNTER_BLOCK)
 {
+  if(column_reader.num_cols() == 1) {
+    dp_single_column(options, column_reader, haplotype1, haplotype2, step_global, OPT_global,
+                     MAX_COV_global, MAX_L_global, MAX_K_global, MAX_GAPS_global);
+    DEBUG("> Block " << COUNTER_BLOCK << " of a single column solved in closed form");
+    return;
+  }
+  if(!options.all_heterozygous &&
+     dp_two_reads(options, column_reader, haplotype1, haplotype2, step_global, OPT_global,
+                  MAX_COV_global, MAX_L_global, MAX_K_global, MAX_GAPS_global)) {
+    DEBUG("> Block " << COUNTER_BLOCK << " of coverage 2 solved in closed form");
+    return;
+  }
+
   Counter MAX_COV = 0;
   Counter MAX_K = 0;
   Counter MAX_L = 0;
   Counter MAX_GAPS = 0;
   Counter num_col = 0;
-  vector<Counter> sum_successive_L;
-  vector<vector<Counter> > scheme_backtrace;
-
-  computeInputParams(num_col, MAX_COV, MAX_L, MAX_K, MAX_GAPS, sum_successive_L,
-                     column_reader, scheme_backtrace, options);
+  computeInputParams(num_col, MAX_COV, MAX_L, MAX_K, MAX_GAPS, context,
+                     column_reader, options);
 
   MAX_COV_global = max(MAX_COV_global, MAX_COV);
   MAX_K_global = max(MAX_K_global, MAX_K);
@@ -416,119 +1024,173 @@ void dp(const constants_t &constants, const options_t &options, ColumnReader1 &c
   DEBUG("::== no of columns:     " << num_col);
   //DEBUG("-->> sum_successive_L:  " << sum_successive_L);
 
+  //The projections of the masks of at most 64 reads are gathered by BMI2 if
+  //the CPU supports it (and its pext is fast)
+  static const bool bmi2 = use_bmi2();
+  if(MAX_COV <= 32 && bmi2) {
+    dp_kernel<bitset<32>, Bmi2Bits>(options, context, column_reader, haplotype1, haplotype2, step_global,
+                                    OPT_global, masks_global, infeasible_global, COUNTER_BLOCK, num_col,
+                                    MAX_COV, MAX_L, MAX_K);
+  } else if(MAX_COV <= 32) {
+    dp_kernel<bitset<32>, PortableBits>(options, context, column_reader, haplotype1, haplotype2, step_global,
+                                        OPT_global, masks_global, infeasible_global, COUNTER_BLOCK, num_col,
+                                        MAX_COV, MAX_L, MAX_K);
+  } else if(MAX_COV <= 64 && bmi2) {
+    dp_kernel<bitset<64>, Bmi2Bits>(options, context, column_reader, haplotype1, haplotype2, step_global,
+                                    OPT_global, masks_global, infeasible_global, COUNTER_BLOCK, num_col,
+                                    MAX_COV, MAX_L, MAX_K);
+  } else if(MAX_COV <= 64) {
+    dp_kernel<bitset<64>, PortableBits>(options, context, column_reader, haplotype1, haplotype2, step_global,
+                                        OPT_global, masks_global, infeasible_global, COUNTER_BLOCK, num_col,
+                                        MAX_COV, MAX_L, MAX_K);
+  } else {
+    dp_kernel<bitset<MAX_COVERAGE>, PortableBits>(options, context, column_reader, haplotype1, haplotype2,
+                                                  step_global, OPT_global, masks_global, infeasible_global,
+                                                  COUNTER_BLOCK, num_col, MAX_COV, MAX_L, MAX_K);
+  }
+}
+
+
+template <typename BitColumn, typename Bits>
+void dp_kernel(const options_t &options, SolverContext &context, ColumnReader1 &column_reader,
+               vector<bool> &haplotype1, vector<bool> &haplotype2, Counter &step_global, Cost &OPT_global,
+               mask_counters_t &masks_global, infeasible_t &infeasible_global, const Counter &COUNTER_BLOCK,
+               const Counter &num_col, const Counter &MAX_COV, const Counter &MAX_L, const Counter &MAX_K)
+{
+  const vector<Counter> &sum_successive_L = context.sum_successive_L;
+  const vector<vector<Counter> > &scheme_backtrace = context.scheme_backtrace;
+
   //.:: ALLOCATION MEMORY
 
   DEBUG(">> Starting allocation of memory");
+  //The buffers are taken from the context and only grow from a block to the
+  //following ones
   //Allocation of memory for input window
-  vector<Column> input(2 * (MAX_L - 1) + 1,
-                       Column(MAX_COV,
-                              Entry(-1, Entry::BLANK, 0)));
+  vector<Column> &input = context.input;
+  context.reset(input, 2 * (MAX_L - 1) + 1, MAX_COV, Entry(-1, Entry::BLANK, 0));
   Pointer input_pointer = 0;
   TRACE("-->> input allocated");
 
 
   //Allocation of memory for backward indexer
   //The index in j of the shared elements between p and j
-  vector<vector<Pointer> > back_indexer(2 * (MAX_L - 1) + 1,
-                                      vector<Pointer>(MAX_COV,
-                                                      -1));
+  vector<vector<Pointer> > &back_indexer = context.back_indexer;
+  context.reset(back_indexer, 2 * (MAX_L - 1) + 1, MAX_COV, (Pointer)-1);
   //Equal to indexer_pointer
   TRACE("-->> back indexer allocated");
 
   //Allocation of memory for forward indexer
   //The index in p of the shared elements between p and j
-  vector<vector<Pointer> > forw_indexer(2 * (MAX_L - 1) + 1,
-                                      vector<Pointer>(MAX_COV,
-                                                      -1));
+  vector<vector<Pointer> > &forw_indexer = context.forw_indexer;
+  context.reset(forw_indexer, 2 * (MAX_L - 1) + 1, MAX_COV, (Pointer)-1);
   const Pointer indexer_pointer = MAX_L - 1;
   TRACE("-->> forw indexer allocated");
 
   //Allocation of memory for pos_gaps
   //The considered gaps are the ones in the column with the lower index
-  vector<BitColumn> pos_gaps(2 * (MAX_L - 1) + 1);
+  vector<BitColumn> &pos_gaps = context.bit_buffers<BitColumn>().pos_gaps;
+  pos_gaps.assign(2 * (MAX_L - 1) + 1, BitColumn());
   //Equal to indexer_pointer
   TRACE("-->> pos_gaps allocated");
 
+  //Allocation of memory for the projections of the mask of j on the other columns
+  vector<MaskProjection<BitColumn> > &projections = context.bit_buffers<BitColumn>().projections;
+  projections.resize(2 * (MAX_L - 1) + 1);
+  //Equal to indexer_pointer
+  vector<Counter> &no_gap_reads = context.no_gap_reads;
+  vector<Counter> &gap_reads = context.gap_reads;
+  TRACE("-->> projections allocated");
+
+  //The batch of masks evaluated together, and the kernel that reduces it
+  MaskBatch &batch = context.batch;
+  static const MaskBatch::relax_t relax = MaskBatch::relax_kernel();
+
+  //The threads of the DP, kept from a block to the following ones, and the
+  //ranges of the masks that they evaluate
+  if(options.dp_threads > 1 && !context.pool) {
+    context.pool.reset(new WorkerPool(options.dp_threads));
+  }
+  vector<MaskRange<BitColumn> > &ranges = context.bit_buffers<BitColumn>().ranges;
+  if(ranges.size() < options.dp_threads) {
+    ranges.resize(options.dp_threads);
+  }
+
   //Allocation of memory for num_pos_gaps
   //The considered gaps are the ones in the column with the lower index
-  vector<Counter> num_pos_gaps(2 * (MAX_L - 1) + 1);
+  vector<Counter> &num_pos_gaps = context.num_pos_gaps;
+  num_pos_gaps.assign(2 * (MAX_L - 1) + 1, 0);
   //Equal to indexer_pointer
   TRACE("-->> num_pos_gaps allocated");
 
 
   //Allocation of memory for vector of k_j
-  vector<Counter> k_j(2 * (MAX_L - 1) + 1,
-                      MAX_K);
+  vector<Counter> &k_j = context.k_j;
+  k_j.assign(2 * (MAX_L - 1) + 1, MAX_K);
   //its pointer is equal to input_pointer
   TRACE("-->> k_j allocated");
 
   //Allocation of memory for homozigous costs
-  vector<Counter> homo_cost(2 * (MAX_L - 1) + 1,
-                            MAX_COUNTER);
+  vector<Counter> &homo_cost = context.homo_cost;
+  homo_cost.assign(2 * (MAX_L - 1) + 1, MAX_COUNTER);
   //its pointer is equal to input_pointer
   TRACE("-->> homo_cost allocated");
 
   //Allocation of memory for homozigous weights
-  vector<Cost> homo_weight(2 * (MAX_L - 1) + 1,
-                           Cost::INFTY);
+  vector<Cost> &homo_weight = context.homo_weight;
+  homo_weight.assign(2 * (MAX_L - 1) + 1, Cost::INFTY);
   //its pointer is equal to input_pointer
   TRACE("-->> homo_weight allocated");
 
   //Allocation of memory for prevision matrix
   //[Destinatary of prevision][Who make the prevision][Indexof(mask of who makes prevision on common fragments)]
 
-  vector<vector<vector<Cost> > > prevision(MAX_L,
-                                           vector<vector<Cost> > (MAX_L,
-                                                                  vector<Cost>(0)));
-
-  for(unsigned int j = 0; j < MAX_L; j++) {
-    for(unsigned int q = 0; q < MAX_L; q++) {
-      prevision[j][q].resize(sum_successive_L[q],
-                             Cost::INFTY);
-    }
-  }
+  PrevisionTable &prevision = context.prevision;
+  prevision.reset(MAX_L, sum_successive_L);
   Pointer prevision_pointer = 0;
   TRACE("-->> prevision allocated");
 
   //Allocation of memory for OPT vector
-  vector<Cost> OPT(MAX_L + 1,
-                   Cost::INFTY);        //+ 1 since I need OPT[j - L]
+  vector<Cost> &OPT = context.OPT;
+  OPT.assign(MAX_L + 1, Cost::INFTY);        //+ 1 since I need OPT[j - L]
   Pointer OPT_pointer = 0;
   TRACE("-->> OPT allocated");
 
   //Allocation of memory for backtrace column
-  vector<vector<vector<Backtrace1> > > backtrace_table1(num_col);
-  vector<vector<vector<bool> > > backtrace_table2_haplotypes(num_col);
-  vector<vector<vector<bool> > > backtrace_table2_new_block(num_col);
-
-  for(unsigned int j = 0; j < num_col; j++) {
-    backtrace_table1[j].resize(scheme_backtrace[j].size());
-    backtrace_table2_haplotypes[j].resize(scheme_backtrace[j].size());
-    backtrace_table2_new_block[j].resize(scheme_backtrace[j].size());
-    for(unsigned int q = 0; q < backtrace_table1[j].size(); q++) {
-      backtrace_table1[j][q].resize(scheme_backtrace[j][q]);
-      backtrace_table2_haplotypes[j][q].resize(scheme_backtrace[j][q]);
-      backtrace_table2_new_block[j][q].resize(scheme_backtrace[j][q]);
-    }
-  }
-  TRACE("-->> Backtrace table allocated");
-
-
-  vector<bool> is_homozygous(num_col);
-  vector<bool> homo_haplotypes(num_col);
-  vector<Backtrace1> best_heterozygous1(num_col);
-  vector<bool> best_heterozygous2_haplotypes(num_col);
-  vector<bool> best_heterozygous2_new_block(num_col);
+  //In low-memory mode the table holds only a segment of the columns (and the
+  //MAX_L - 1 columns before it): the frontier of the DP is saved at the start
+  //of each segment, and the segments are computed again, from the last one,
+  //while the haplotypes are reconstructed.
+  const Counter max_row = BacktraceTable::max_row_size(scheme_backtrace);
+  const Counter segment = options.low_memory
+    ? segment_length(num_col, prevision.memory(), scheme_backtrace,
+                     BacktraceTable::entry_bits_of(MAX_L, max_row))
+    : num_col;
+  BacktraceTable &backtrace_table = context.backtrace;
+  backtrace_table.reset(scheme_backtrace, MAX_L, max_row, 0, min(num_col, segment + 1));
+  vector<dp_checkpoint_t> checkpoints;
+  TRACE("-->> Backtrace table allocated (" << backtrace_table.memory() << " bytes)");
+
+
+  vector<bool> &is_homozygous = context.is_homozygous;
+  is_homozygous.assign(num_col, false);
+  vector<bool> &homo_haplotypes = context.homo_haplotypes;
+  homo_haplotypes.assign(num_col, false);
+  vector<Backtrace1> &best_heterozygous1 = context.best_heterozygous1;
+  best_heterozygous1.assign(num_col, Backtrace1());
+  vector<bool> &best_heterozygous2_haplotypes = context.best_heterozygous2_haplotypes;
+  best_heterozygous2_haplotypes.assign(num_col, false);
+  vector<bool> &best_heterozygous2_new_block = context.best_heterozygous2_new_block;
+  best_heterozygous2_new_block.assign(num_col, false);
 
 
   DEBUG(">> Completed allocation of memory");
 
   //INITIALIZATION
 
-  Combinations generator;
+  const constants_t<BitColumn> constants;
   column_reader.restart();
   Counter step = 0;
-  Column column;
+  const Column empty_column;
 
 
   //Place the first and the next L columns in the positions of input data structure
@@ -541,12 +1203,11 @@ void dp(const constants_t &constants, const options_t &options, ColumnReader1 &c
   do {
     Pointer new_l_pointer = next(input_pointer, input.size(), l);
 
-    if(l == 0) {
-      column.clear();
-    } else {
+    //The first column is the starting dummy empty column
+    if(l != 0) {
       flag = column_reader.has_next();
-      column = column_reader.get_next();
     }
+    const Column &column = (l == 0) ? empty_column : column_reader.get_next();
 
     insert_col_and_update(input, k_j, homo_cost, homo_weight, new_l_pointer, column,
                           options, homo_haplotypes, step + l);
@@ -565,8 +1226,6 @@ void dp(const constants_t &constants, const options_t &options, ColumnReader1 &c
   BitColumn colj;
   BitColumn gaps_mask;
   BitColumn mask;
-  BitColumn comb_no_gaps;
-  BitColumn comb_gaps;
   Cost current_cost(Cost::INFTY);
   Cost current_best(Cost::INFTY);
   Counter cov_j(0);
@@ -574,13 +1233,9 @@ void dp(const constants_t &constants, const options_t &options, ColumnReader1 &c
   bool feasibility;
   bool has_successive;
   bool solution_existence(true);
-  Counter temp_jump(-1);
-  Counter temp_index(0);
-  bool temp_haplotypes(false);
-  bool temp_new_block(false);
 
-  BitColumn cut_mask;
   BitColumn mask_qj;
+  Counter active_qj(0);
 
   //Base case for OPT
   OPT[OPT_pointer] = 0;
@@ -608,8 +1263,7 @@ void dp(const constants_t &constants, const options_t &options, ColumnReader1 &c
       //The number of elements shared between p and j
       Pointer new_prevision_pointer = next(prevision_pointer, prevision.size(), p);
 
-      prevision[new_prevision_pointer][p].resize(1);
-      prevision[new_prevision_pointer][p][0] = current_cost;
+      prevision.row(new_prevision_pointer, p)[0] = current_cost;
 
       p++;
     }
@@ -618,382 +1272,406 @@ void dp(const constants_t &constants, const options_t &options, ColumnReader1 &c
 
   DEBUG("-->> Basic case completed  -- current_cost: " << current_cost);
 
+  if(segment < num_col) {
+    checkpoints.push_back(dp_checkpoint_t());
+    save_checkpoint(checkpoints.back(), step, input, input_pointer, k_j, homo_cost, homo_weight,
+                    prevision, prevision_pointer, OPT, OPT_pointer, column_reader,
+                    backtrace_table, scheme_backtrace, MAX_L);
+  }
+
 
   //DP
 
-  //For all the columns
+  haplotype_walk_t walk(num_col);
+  Counter last_step = num_col;
+  bool recomputing = false;
 
-  while(!check_end(column_reader, input, next(input_pointer, input.size(), 1)) && solution_existence)
-    {
-      current_best = Cost::INFTY;
-      solution_existence = false;
-      temp_jump = -1;
-      temp_index = 0;
-      temp_haplotypes = false;
-      temp_new_block = false;
-      step++;
-      step_global++;
-      DEBUG("STARTING STEP:  " << step);
+  while(true) {
+    //For all the columns
 
-      // >>>>>>>>>>>>>>>>>>>>>> UPDATE DATA STRUCTURE <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+    while(step < last_step && !check_end(column_reader, input, next(input_pointer, input.size(), 1)) && solution_existence)
+      {
+        current_best = Cost::INFTY;
+        solution_existence = false;
+        step++;
+        if(!recomputing) {
+          step_global++;
+        }
+        DEBUG("STARTING STEP:  " << step);
 
-      //.:: Read Column
-      column = column_reader.get_next();
+        // >>>>>>>>>>>>>>>>>>>>>> UPDATE DATA STRUCTURE <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
-      //.:: Update input
+        //.:: Read Column
+        const Column &column = column_reader.get_next();
 
-      //.:: Update common pointer
-      input_pointer = next(input_pointer, input.size(), 1);
+        //.:: Update input
 
-      Pointer new_input_pointer = next(input_pointer, input.size(), MAX_L - 1);
+        //.:: Update common pointer
+        input_pointer = next(input_pointer, input.size(), 1);
 
-      insert_col_and_update(input, k_j, homo_cost, homo_weight, new_input_pointer,
-                            column, options, homo_haplotypes, step + (MAX_L - 1));
+        Pointer new_input_pointer = next(input_pointer, input.size(), MAX_L - 1);
 
-      //.:: Update indexers
+        insert_col_and_update(input, k_j, homo_cost, homo_weight, new_input_pointer,
+                              column, options, homo_haplotypes, step + (MAX_L - 1));
 
+        //.:: Update indexers
 
-      //For all the q successive columns
-      for(unsigned int q = 1; q < MAX_L; q++)
-        {
-          intersect(input[next(input_pointer, input.size(), q)],
-                    input[input_pointer],
-                    indexer_pointer + q,
-                    forw_indexer, back_indexer,
-                    pos_gaps, num_pos_gaps, false);
-
-          //If the just considered column q did not have any common element, we can fill as
-          //  empty all the remaining columns and terminate.
-          if(forw_indexer[indexer_pointer + q][0] == -1)
-            {
-              for(unsigned int p = q + 1; p < MAX_L; p++)
-                {
-                  forw_indexer[indexer_pointer + p][0] = -1;
-                  back_indexer[indexer_pointer + p][0] = -1;
-                  //pos_gaps[indexer_pointer + p].reset();
-                }
-              q = MAX_L;
-            }
-        }
 
-      //For all the previous q columns
-      for(unsigned int q = 1; q < MAX_L; q++)
-        {
-          intersect(input[prev(input_pointer, input.size(), q)],
-                    input[input_pointer],
-                    indexer_pointer - q,
-                    forw_indexer, back_indexer,
-                    pos_gaps, num_pos_gaps, true);
-
-          //If the just considered column q did not have any common element, we can fill as
-          //  empty all the remaining columns and terminate.
-          if(forw_indexer[indexer_pointer -  q][0] == -1)
-            {
-              for(unsigned int p = q + 1; p < MAX_L; p++)
-                {
-                  forw_indexer[indexer_pointer - p][0] = -1;
-                  back_indexer[indexer_pointer - p][0] = -1;
-                  //pos_gaps[indexer_pointer - p].reset();
-                }
-              q = MAX_L;
-            }
-        }
+        //For all the q successive columns
+        for(unsigned int q = 1; q < MAX_L; q++)
+          {
+            intersect(input[next(input_pointer, input.size(), q)],
+                      input[input_pointer],
+                      indexer_pointer + q,
+                      forw_indexer, back_indexer,
+                      pos_gaps, num_pos_gaps, false);
 
+            //If the just considered column q did not have any common element, we can fill as
+            //  empty all the remaining columns and terminate.
+            if(forw_indexer[indexer_pointer + q][0] == -1)
+              {
+                for(unsigned int p = q + 1; p < MAX_L; p++)
+                  {
+                    forw_indexer[indexer_pointer + p][0] = -1;
+                    back_indexer[indexer_pointer + p][0] = -1;
+                    //pos_gaps[indexer_pointer + p].reset();
+                  }
+                q = MAX_L;
+              }
+          }
 
-      //.:: Update prevision
-      //XXX: Ricontrollare
-      prevision_pointer = next(prevision_pointer, prevision.size(), 1);
-      Pointer new_prevision_pointer = next(prevision_pointer, prevision.size(), MAX_L - 1);
-      Pointer last_input_pointer = next(input_pointer, input.size(), MAX_L - 1);
+        //For all the previous q columns
+        for(unsigned int q = 1; q < MAX_L; q++)
+          {
+            intersect(input[prev(input_pointer, input.size(), q)],
+                      input[input_pointer],
+                      indexer_pointer - q,
+                      forw_indexer, back_indexer,
+                      pos_gaps, num_pos_gaps, true);
+
+            //If the just considered column q did not have any common element, we can fill as
+            //  empty all the remaining columns and terminate.
+            if(forw_indexer[indexer_pointer -  q][0] == -1)
+              {
+                for(unsigned int p = q + 1; p < MAX_L; p++)
+                  {
+                    forw_indexer[indexer_pointer - p][0] = -1;
+                    back_indexer[indexer_pointer - p][0] = -1;
+                    //pos_gaps[indexer_pointer - p].reset();
+                  }
+                q = MAX_L;
+              }
+          }
 
-      //Notice: prevision[new_prevision_pointer].size() == MAX_L
-      for(unsigned int i = 1; i < prevision[new_prevision_pointer].size(); i++)
-        {
-          Pointer prec_input_pointer = prev(last_input_pointer, input.size(), i);
-          unsigned int common_gaps = 0;
-          Counter active_common = compute_active_common(input[prec_input_pointer], input[last_input_pointer], common_gaps);
 
-          unsigned int combinations = 0;
+        //.:: Update prevision
+        //XXX: Ricontrollare
+        prevision_pointer = next(prevision_pointer, prevision.size(), 1);
+        Pointer new_prevision_pointer = next(prevision_pointer, prevision.size(), MAX_L - 1);
+        Pointer last_input_pointer = next(input_pointer, input.size(), MAX_L - 1);
 
-          combinations = binom_coeff::cumulative_binomial_coefficient(active_common - common_gaps, k_j[prec_input_pointer]) << common_gaps;
+        for(unsigned int i = 1; i < MAX_L; i++)
+          {
+            Pointer prec_input_pointer = prev(last_input_pointer, input.size(), i);
+            unsigned int common_gaps = 0;
+            Counter active_common = compute_active_common(input[prec_input_pointer], input[last_input_pointer], common_gaps);
 
-          // if(active_common != common_gaps) {
-          //   combinations = binom_coeff::cumulative_binomial_coefficient(active_common - common_gaps, k_j[prec_input_pointer]) << common_gaps;
-          // } else {
-          //   //combinations = binom_coeff::cumulative_binomial_coefficient(common_gaps, common_gaps);
-          //   combinations = 1 << common_gaps;
-          // }
+            unsigned int combinations = 0;
 
-          fill(prevision[new_prevision_pointer][i].begin(),
-               (prevision[new_prevision_pointer][i].begin() + combinations),
-               Cost::INFTY);
-        }
+            combinations = binom_coeff::cumulative_binomial_coefficient(active_common - common_gaps, k_j[prec_input_pointer]) << common_gaps;
 
+            // if(active_common != common_gaps) {
+            //   combinations = binom_coeff::cumulative_binomial_coefficient(active_common - common_gaps, k_j[prec_input_pointer]) << common_gaps;
+            // } else {
+            //   //combinations = binom_coeff::cumulative_binomial_coefficient(common_gaps, common_gaps);
+            //   combinations = 1 << common_gaps;
+            // }
 
-      //.:: Update OPT
+            Cost *row = prevision.row(new_prevision_pointer, i);
+            fill(row, row + combinations, Cost::INFTY);
+          }
 
-      OPT_pointer = next(OPT_pointer, OPT.size(), 1);
-      OPT[OPT_pointer] = Cost::INFTY;
 
+        //.:: Update OPT
 
-      DEBUG(">> Update data structure completed");
+        OPT_pointer = next(OPT_pointer, OPT.size(), 1);
+        OPT[OPT_pointer] = Cost::INFTY;
 
-      //>>>>>>>>>>>>>>>>>>>>> END UPDATE <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
-      //>>>>>>>>>>>>>>>>>>>>> ITERATIVE STEP <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
+        DEBUG(">> Update data structure completed");
 
-      //Binary repesentation of the column and compute of coverage
-      represent_column(input[input_pointer], colj, cov_j, gaps_mask, num_gaps);
+        //>>>>>>>>>>>>>>>>>>>>> END UPDATE <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
-      DEBUG("...| Column: " <<  column_to_string(colj, cov_j) << " -- current coverage: " << cov_j << " and current k: " << k_j[input_pointer]);
-      DEBUG("...| #of gaps: " << num_gaps << "  and their positions: " << column_to_string(gaps_mask, cov_j));
+        //>>>>>>>>>>>>>>>>>>>>> ITERATIVE STEP <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
-      //Initializing OPT[j] = infinite
-      //XXX: Is it redundant??
-      //OPT[OPT_pointer] = Cost::INFTY;
+        //Binary repesentation of the column and compute of coverage
+        represent_column(input[input_pointer], colj, cov_j, gaps_mask, num_gaps);
 
-      //We have already computed k, homo_weights and homo_cost for current column
+        DEBUG("...| Column: " <<  column_to_string(colj, cov_j) << " -- current coverage: " << cov_j << " and current k: " << k_j[input_pointer]);
+        DEBUG("...| #of gaps: " << num_gaps << "  and their positions: " << column_to_string(gaps_mask, cov_j));
 
-      //First option for the value of OPT[j]
-      if(homo_cost[input_pointer] <= k_j[input_pointer])
-        {
-          //XXX: Can I remove this check?
-          Cost temp = homo_weight[input_pointer] + OPT[prev(OPT_pointer, OPT.size(), 1)];
-          if(temp < OPT[OPT_pointer]) {
-            OPT[OPT_pointer] =  temp;
-            solution_existence = true;
-            is_homozygous[step] = true;
-            DEBUG(".:: Column: " << step << " can be homozygous with a cost: " << OPT[OPT_pointer]);
+        //The reads of j indexed by the combinations without and with gaps
+        no_gap_reads.clear();
+        gap_reads.clear();
+        for(Counter i = 0; i < cov_j; ++i) {
+          if(gaps_mask[i]) {
+            gap_reads.push_back(i);
+          } else {
+            no_gap_reads.push_back(i);
           }
         }
 
-      //Enumerate all the combinations
-
-      generator.initialize_cumulative(cov_j - num_gaps, k_j[input_pointer]);
-      while(generator.has_next())
-        {
-          generator.next();
-          generator.get_combination(comb_no_gaps);
-          TRACE("Combination of not gaps: " << column_to_string(comb_no_gaps, cov_j - num_gaps));
-
-          Counter comb_gaps_int = 0;
-          do {
-            BitColumn comb_gaps(comb_gaps_int);
-
-            TRACE("Combination of gaps: " << column_to_string(comb_gaps, num_gaps));
-
-            make_mask(mask, gaps_mask, cov_j, comb_gaps, comb_no_gaps);
-
-            TRACE("|--------");
-            TRACE("|== Mask: " << column_to_string(mask, cov_j));
-
-            //Initialize D[j, C'j] to infinite
-            current_cost = Cost::INFTY;
-
-            //Compute C'j
-            //corrected_colj = colj ^ mask;
-            TRACE("-->> corrected column: " << column_to_string(colj ^ mask, cov_j));
-
-            //The column cannot be transformed into an homozygous column
-            //if(corrected_colj.any() && (corrected_colj.count() != cov_j) )
-            //{
-            //Compute the weight of the mask
-            Cost weight_mask = 0;
+        //Projections of the empty mask on the previous and on the successive columns
+        mask.reset();
+        Pointer first_projection = indexer_pointer;
+        Pointer end_projection = indexer_pointer + 1;
+        for(unsigned int q = 1; q < MAX_L && forw_indexer[indexer_pointer - q][0] != -1; q++)
+          {
+            extract_common_mask(input[prev(input_pointer, input.size(), q)], indexer_pointer - q, input[input_pointer],
+                                mask, back_indexer, forw_indexer, mask_qj, active_qj);
+            projections[indexer_pointer - q].reset(back_indexer[indexer_pointer - q], pos_gaps[indexer_pointer - q],
+                                                   mask_qj, cov_j);
+            first_projection = indexer_pointer - q;
+          }
+        for(unsigned int p = 1; p < MAX_L && forw_indexer[indexer_pointer + p][0] != -1; p++)
+          {
+            projections[indexer_pointer + p].reset(back_indexer[indexer_pointer + p], pos_gaps[indexer_pointer + p],
+                                                   constants.zeroes, cov_j);
+            end_projection = indexer_pointer + p + 1;
+          }
 
-            if (options.unweighted) {
-              weight_mask = Cost((Cost::cost_t)mask.count());
-            } else {
-              compute_weight_mask(mask, input[input_pointer], weight_mask);
+        //Initializing OPT[j] = infinite
+        //XXX: Is it redundant??
+        //OPT[OPT_pointer] = Cost::INFTY;
+
+        //We have already computed k, homo_weights and homo_cost for current column
+
+        //First option for the value of OPT[j]
+        if(homo_cost[input_pointer] <= k_j[input_pointer])
+          {
+            //XXX: Can I remove this check?
+            Cost temp = homo_weight[input_pointer] + OPT[prev(OPT_pointer, OPT.size(), 1)];
+            if(temp < OPT[OPT_pointer]) {
+              OPT[OPT_pointer] =  temp;
+              solution_existence = true;
+              is_homozygous[step] = true;
+              DEBUG(".:: Column: " << step << " can be homozygous with a cost: " << OPT[OPT_pointer]);
             }
+          }
 
-            //Compute current_cost that corresponds to D[j, Bj]
-
-            Counter q = 1;
-            Pointer new_homo_pointer = prev(input_pointer, input.size(), q - 1);
-            bool has_previous = true;
-            Cost cumulative_homo = 0;
-
-            do {
-              //All the condition that have to be satisfied for the next column
-              feasibility = (q - 1 == 0) || (homo_cost[new_homo_pointer] <= k_j[new_homo_pointer]);
-
-              if (q >= MAX_L || forw_indexer[indexer_pointer - q][0] == -1 || !feasibility) {
-                has_previous = false;
-              } else {
-                Counter active_qj(0);
-                Cost temp(0);
-
-                Pointer new_q_pointer = prev(input_pointer, input.size(), q);
-
-                //First Mask
-                extract_common_mask(input[new_q_pointer], indexer_pointer - q, input[input_pointer],
-                                    mask, back_indexer, forw_indexer, mask_qj, active_qj);
-
-                const Counter ungaps_q_corrected = (mask_qj&((pos_gaps[indexer_pointer - q]|constants.zeroes).flip())).count();
+        //The previous columns that the masks of j look up, as long as the
+        //columns between them and j can be homozygous (the same for all the
+        //masks of j)
+        batch.previous.clear();
+        Counter q = 1;
+        Cost cumulative_homo = 0;
+        while(true) {
+          const Pointer new_homo_pointer = prev(input_pointer, input.size(), q - 1);
+          feasibility = (q - 1 == 0) || (homo_cost[new_homo_pointer] <= k_j[new_homo_pointer]);
+          if (q >= MAX_L || forw_indexer[indexer_pointer - q][0] == -1 || !feasibility) {
+            break;
+          }
+          //Every mask of q makes a prevision for j, hence the least one is
+          //at least OPT[q]
+          const MaskBatch::neighbour_t neighbour = { q, k_j[prev(input_pointer, input.size(), q)],
+                                                     cumulative_homo, prevision.row(prevision_pointer, q),
+                                                     OPT[prev(OPT_pointer, OPT.size(), q)] + cumulative_homo };
+          batch.previous.push_back(neighbour);
+          q++;
+          cumulative_homo += homo_weight[prev(input_pointer, input.size(), q - 1)];
+        }
 
-                if(ungaps_q_corrected <= k_j[new_q_pointer])
-                  {
-                    //Counter index = generator.cumulative_indexof(mask_qj, active_qj);
-                    //Leave .count()
-                    Counter index = compute_index_of(mask_qj, active_qj, num_pos_gaps[indexer_pointer - q],
-                                                     pos_gaps[indexer_pointer - q], generator);
-                    temp = prevision[prevision_pointer][q][index] + weight_mask + cumulative_homo;
-                    if(temp < current_cost) {
-                      current_cost = temp;
-                      solution_existence = true;
-
-                      temp_jump = q;
-                      temp_index = index;
-                      temp_haplotypes = backtrace_table2_haplotypes[step - q][q][index];
-                      temp_new_block = false;
-                    }
-                    TRACE("-->> Temporary current cost: " << current_cost);
-                    TRACE("---->> the previous equal heterozigous is " << (step - q)
-                          << "  -- its mask: " << column_to_string(mask_qj, active_qj));
-                  }
+        //Third case of the recursion for D[j, C'j]: j is the first heterozygous
+        //column of a new block
+        //XXX: Check carefully!
+        const bool new_block = (q <= MAX_L && feasibility);
+        const Counter new_block_jump = q;
+        const Cost new_block_homo = cumulative_homo;
+        const Cost *new_block_OPT = &OPT[prev(OPT_pointer, OPT.size(), q)];
+
+        //The successive columns that the masks of j make a prevision for
+        batch.successive.clear();
+        for(Counter p = 1; ; p++) {
+          const Pointer new_homo_pointer = next(input_pointer, input.size(), p - 1);
+          feasibility = (p - 1 == 0) || (homo_cost[new_homo_pointer] <= k_j[new_homo_pointer]);
+          if (p >= MAX_L || forw_indexer[indexer_pointer + p][0] == -1 || !feasibility) {
+            break;
+          }
+          const MaskBatch::neighbour_t neighbour = { p, 0, 0,
+                                                     prevision.row(next(prevision_pointer, prevision.size(), p), p),
+                                                     Cost::INFTY };
+          batch.successive.push_back(neighbour);
+        }
+        batch.reset_lanes();
+
+        //Lower bound of the lookups of the masks of j (the least lookup in
+        //the previous columns or in the third case). The least weight of the
+        //masks of i reads without a gap is the sum of the i least phred
+        //scores (or i, if unweighted).
+        Cost lower_bound = Cost::INFTY;
+        for(size_t i = 0; i < batch.previous.size(); ++i) {
+          replace_if_less(lower_bound, batch.previous[i].least);
+        }
+        if(new_block) {
+          replace_if_less(lower_bound, *new_block_OPT + new_block_homo);
+        }
+        vector<Cost> &min_weight = context.min_weight;
+        min_weight.resize(no_gap_reads.size() + 1);
+        min_weight[0] = 0;
+        for(size_t i = 0; i < no_gap_reads.size(); ++i) {
+          min_weight[i + 1] = options.unweighted ? 1 : input[input_pointer][no_gap_reads[i]].get_phred_score();
+        }
+        sort(min_weight.begin() + 1, min_weight.end());
+        for(size_t i = 1; i < min_weight.size(); ++i) {
+          min_weight[i] = min_weight[i - 1] + min_weight[i];
+        }
 
-                //Complement
-                complement_mask(mask_qj, active_qj, constants);
+        //Evaluate the masks of j, split into ranges of the combinations of
+        //the reads without gaps if they are many and there are threads
+        const dp_step_t data = { step, &input[input_pointer], &no_gap_reads, &gap_reads,
+                                 cov_j, num_gaps, k_j[input_pointer],
+                                 first_projection, indexer_pointer, end_projection,
+                                 options.unweighted, relax,
+                                 new_block, new_block_jump, new_block_homo, new_block_OPT,
+                                 &backtrace_table, lower_bound, &min_weight[0] };
+        const Counter no_gap_combinations =
+          binom_coeff::cumulative_binomial_coefficient(cov_j - num_gaps, k_j[input_pointer]);
+        unsigned int parts = 1;
+        if(context.pool && no_gap_combinations != BINOMIAL_OVERFLOW) {
+          const unsigned long long masks = (unsigned long long)no_gap_combinations << num_gaps;
+          parts = (unsigned int)max(1ULL, min((unsigned long long)context.pool->size(),
+                                              masks / MaskRange<BitColumn>::MIN_MASKS));
+        }
+        if(parts == 1) {
+          ranges[0].reset(0, MAX_COUNTER, batch.successive.size());
+          evaluate_masks<BitColumn, Bits>(data, ranges[0], projections, batch, &backtrace_table);
+        } else {
+          for(unsigned int part = 0; part < parts; ++part) {
+            ranges[part].reset((Counter)((unsigned long long)no_gap_combinations * part / parts),
+                               (Counter)((unsigned long long)no_gap_combinations * (part + 1) / parts),
+                               batch.successive.size());
+          }
+          dp_ranges_task_t<BitColumn, Bits> task(data, ranges, parts, projections, batch);
+          context.pool->run(task);
+        }
 
-                if((active_qj - num_pos_gaps[indexer_pointer - q] - ungaps_q_corrected) <= k_j[new_q_pointer])
-                  {
-                    //Counter index = generator.cumulative_indexof(mask_qj, active_qj);
-                    Counter index = compute_index_of(mask_qj, active_qj, num_pos_gaps[indexer_pointer - q],
-                                                     pos_gaps[indexer_pointer - q], generator);
-                    temp = prevision[prevision_pointer][q][index] + weight_mask + cumulative_homo;
-                    if(temp < current_cost) {
-                      current_cost = temp;
-                      solution_existence = true;
-
-                      temp_jump = q;
-                      temp_index = index;
-                      temp_haplotypes = !backtrace_table2_haplotypes[step - q][q][index];
-                      temp_new_block = false;
-                    }
-                    TRACE("-->> Temporary current cost: " << current_cost);
-                    TRACE("---->> the previous equal heterozigous is " << (step - q)
-                          << "  -- its mask: " << column_to_string(mask_qj, active_qj));
+        //Merge the ranges in their order: the previsions for the successive
+        //columns first, then the best mask of the range
+        for(unsigned int part = 0; part < parts; ++part)
+          {
+            MaskRange<BitColumn> &range = ranges[part];
+            solution_existence = solution_existence || range.solution_existence;
+            if(parts > 1) {
+              for(size_t i = 0; i < batch.successive.size(); ++i) {
+                Cost *row = batch.successive[i].row;
+                for(Counter index = 0; index < range.touched[i]; ++index) {
+                  if(range.previsions[i][index] < row[index]) {
+                    const typename MaskRange<BitColumn>::choice_t &choice = range.choices[i][index];
+                    row[index] = range.previsions[i][index];
+                    backtrace_table.set(step, batch.successive[i].distance, index, choice.jump, choice.index,
+                                        choice.haplotypes, choice.new_block);
                   }
-
-                q++;
-
-                new_homo_pointer = prev(input_pointer, input.size(), q - 1);
-
-                cumulative_homo += homo_weight[new_homo_pointer];
-                TRACE("----> Cumulative homo: " << cumulative_homo << "  with q:  " << q);
-              }
-            } while(has_previous);
-
-            TRACE("-->> Best current cost (D[j, C'j]): "<< current_cost);
-
-            //Third case of the recursion for D[j, C'j]
-            //XXX: Check carefully!
-            if(q <= MAX_L && feasibility) {
-              Cost temp = OPT[prev(OPT_pointer, OPT.size(), q)] + weight_mask + cumulative_homo;
-              if(temp < current_cost) {
-                current_cost = temp;
-                solution_existence = true;
-
-                temp_jump = q;
-                temp_index = 0;
-                temp_haplotypes = false;
-                temp_new_block = true;
-                TRACE("<<>> Third case of recursion - First heterozigous of new block");
-                TRACE("..OPT[previous] = " << OPT[prev(OPT_pointer, OPT.size(), q)] << " - weight:  " << weight_mask << " - cumulative_homo: " << cumulative_homo);
-                //TRACE(".:: Column: " << step << " can be heterozigous with a cost: " << current_cost);
-                //TRACE("====> Best correction:  " << column_to_string(mask, cov_j));
-              }
-            }
-
-            //Make a prevision for all the seccessive column
-            has_successive = true;
-            Counter p = 1;
-
-            //All the condition that have to be satisfied for the next column
-
-            do {
-              Pointer new_homo_pointer = next(input_pointer, input.size(), p - 1);
-              feasibility = (p - 1 == 0) || (homo_cost[new_homo_pointer] <= k_j[new_homo_pointer]);
-
-              if (p >= MAX_L || forw_indexer[indexer_pointer + p][0] == -1 || !feasibility) {
-                has_successive = false;
-              } else {
-                //The number of elements shared between p and j
-                Counter active_pj = 0;
-
-                cut(mask, cut_mask, back_indexer[indexer_pointer + p], active_pj);
-                TRACE("-->> Successive column: " << (step + p)
-                      << " -- Prevision cost: " << current_cost
-                      << " -- Common elements:  " << active_pj << " -- Cut mask: " << cut_mask
-                      << "---" << column_to_string(cut_mask, active_pj));
-
-                //Counter index = generator.cumulative_indexof(cut_mask, active_pj);
-                Counter index = compute_index_of(cut_mask, active_pj, num_pos_gaps[indexer_pointer + p],
-                                                 pos_gaps[indexer_pointer + p], generator);
-                Pointer new_prevision_pointer = next(prevision_pointer, prevision.size(), p);
-                Cost& temp = prevision[new_prevision_pointer][p][index];
-                if(current_cost < temp) {
-                  temp = current_cost;
-
-                  backtrace_table1[step][p][index].jump = temp_jump;
-                  backtrace_table1[step][p][index].index = temp_index;
-                  backtrace_table2_haplotypes[step][p][index] = temp_haplotypes;
-                  backtrace_table2_new_block[step][p][index] = temp_new_block;
                 }
-                TRACE("USCITO:  ");
-                p++;
               }
-            } while(has_successive);
-
+              range.clear_previsions();
+            }
 
-            if(current_cost < current_best) {
-              current_best = current_cost;
+            if(range.best < current_best) {
+              current_best = range.best;
 
-              best_heterozygous1[step].jump = temp_jump;
-              best_heterozygous1[step].index = temp_index;
-              best_heterozygous2_haplotypes[step] = temp_haplotypes;
-              best_heterozygous2_new_block[step] = temp_new_block;
+              best_heterozygous1[step].jump = range.best_choice.jump;
+              best_heterozygous1[step].index = range.best_choice.index;
+              best_heterozygous2_haplotypes[step] = range.best_choice.haplotypes;
+              best_heterozygous2_new_block[step] = range.best_choice.new_block;
             }
 
-
             //Update value of OPT for the current column
             //XXX: Try <= to advantage heterozigosity
-            if(current_cost < OPT[OPT_pointer]) {
-              OPT[OPT_pointer] = current_cost;
+            if(range.best < OPT[OPT_pointer]) {
+              OPT[OPT_pointer] = range.best;
               is_homozygous[step] = false;
               DEBUG(".:: Column: " << step << " can be heterozigous with a cost: " << OPT[OPT_pointer]);
-              DEBUG("====> Best correction:  " << column_to_string(mask, cov_j));
+              DEBUG("====> Best correction:  " << column_to_string(range.best_mask, cov_j));
             }
-            TRACE("-->> OPT: " << OPT[OPT_pointer]);
-            //}
-            ++comb_gaps_int;
-          } while (comb_gaps_int < (unsigned int)(1 << num_gaps));
+          }
+
+        if(!recomputing) {
+          unsigned long long evaluated = 0;
+          for(unsigned int part = 0; part < parts; ++part) {
+            evaluated += ranges[part].evaluated;
+            masks_global.bounded += ranges[part].bounded;
+            masks_global.lookups += ranges[part].lookups;
+            masks_global.bounded_lookups += ranges[part].bounded_lookups;
+          }
+          masks_global.evaluated += evaluated;
+          masks_global.skipped += ((unsigned long long)no_gap_combinations << num_gaps) - evaluated;
         }
 
-      if (step_global % 500 == 0) {
-        INFO(".:: Step: " << step_global << "  ==>  OPT: " << OPT[OPT_pointer] + OPT_global);
-      } else {
-        DEBUG(".:: Step: " << step_global << "  ==>  OPT: " << OPT[OPT_pointer]);
+        if (recomputing) {
+          DEBUG(".:: Step: " << step << " (recomputed)  ==>  OPT: " << OPT[OPT_pointer]);
+        } else if (step_global % 500 == 0) {
+          INFO(".:: Step: " << step_global << "  ==>  OPT: " << OPT[OPT_pointer] + OPT_global);
+        } else {
+          DEBUG(".:: Step: " << step_global << "  ==>  OPT: " << OPT[OPT_pointer]);
+        }
+
+        //Start a new segment
+        if(!recomputing && step % segment == 0 && step + 1 < num_col) {
+          checkpoints.push_back(dp_checkpoint_t());
+          save_checkpoint(checkpoints.back(), step, input, input_pointer, k_j, homo_cost, homo_weight,
+                          prevision, prevision_pointer, OPT, OPT_pointer, column_reader,
+                          backtrace_table, scheme_backtrace, MAX_L);
+          backtrace_table.reset(scheme_backtrace, MAX_L, max_row,
+                                checkpoints.back().backtrace.first_column(),
+                                min(num_col, step + segment + 1));
+          backtrace_table.copy_columns(checkpoints.back().backtrace);
+        }
+        //End of DP cycle for all the columns
       }
-      //End of DP cycle for all the columns
-    }
 
+    if(!solution_existence) {
+      break;
+    }
 
-  if(solution_existence) {
-    DEBUG("*** SUCCESS ***");
-    DEBUG("> Optimal block cost:  " << OPT[OPT_pointer]);
-    OPT_global += OPT[OPT_pointer];
-    DEBUG("===> Optimal global cost:  " << OPT_global);
+    if(!recomputing) {
+      DEBUG("*** SUCCESS ***");
+      DEBUG("> Optimal block cost:  " << OPT[OPT_pointer]);
+      OPT_global += OPT[OPT_pointer];
+      DEBUG("===> Optimal global cost:  " << OPT_global);
+    }
 
-    reconstruct_haplotypes(backtrace_table1, backtrace_table2_haplotypes, backtrace_table2_new_block,
+    reconstruct_haplotypes(backtrace_table, walk,
                            is_homozygous, homo_haplotypes,
                            best_heterozygous1, best_heterozygous2_haplotypes, best_heterozygous2_new_block,
                            haplotype1, haplotype2);
-  } else {
-    INFO("*** NO SOLUTION FOR BLOCK: " << COUNTER_BLOCK);
-    INFO("<<>> No feasible solution exist with these parameters -- alpha = " << options.alpha << " and error rate = " << options.error_rate);
-    INFO("<<>> The last not feasible column is:  " << step << "  with coverage = " << cov_j << " and k = " << k_j[input_pointer]);
-    exit(EXIT_FAILURE);
+    if(walk.col == 0) {
+      break;
+    }
+
+    //The walk needs the backtrace of a previous segment: compute it again from
+    //the checkpoint at its start (the later checkpoints are no longer needed)
+    const Counter k = (walk.col - 1) / segment;
+    DEBUG(">> Recomputing the steps from " << k * segment + 1 << " to " << (k + 1) * segment);
+    checkpoints.resize(k + 1);
+    restore_checkpoint(checkpoints[k], step, input, input_pointer, k_j, homo_cost, homo_weight,
+                       prevision, prevision_pointer, OPT, OPT_pointer, column_reader);
+    backtrace_table.reset(scheme_backtrace, MAX_L, max_row,
+                          checkpoints[k].backtrace.first_column(),
+                          min(num_col, (k + 1) * segment + 1));
+    backtrace_table.copy_columns(checkpoints[k].backtrace);
+    last_step = (k + 1) * segment;
+    recomputing = true;
+  }
+
+
+  if(solution_existence) {
+    DEBUG("> Haplotypes of block " << COUNTER_BLOCK << " reconstructed");
+  } else {
+    infeasible_global.found = true;
+    infeasible_global.block = COUNTER_BLOCK;
+    infeasible_global.step = step;
+    infeasible_global.coverage = cov_j;
+    infeasible_global.k = k_j[input_pointer];
   }
 
 }
@@ -1001,128 +1679,366 @@ void dp(const constants_t &constants, const options_t &options, ColumnReader1 &c
 
 
 
-//Change such that we do not take all the input in memory!!
-void computeInputParams(Counter &num_cols, Counter &MAX_COV, Counter &MAX_L,
-                        Counter &MAX_K, Counter &MAX_GAPS, vector<Counter> &sum_successive_L,
-                        ColumnReader1 &column_reader,
-                        vector<vector<Counter> > &scheme_backtrace,
-                        const options_t &options)
+//Number of the combinations of at most k of n reads and of any subset of
+//further gaps reads (the ones with a gap), which index the DP tables.
+//Exit if it does not fit a Counter.
+static Counter count_combinations(const Counter &n, const Counter &k, const Counter &gaps)
 {
-  column_reader.restart();
-
-  num_cols = column_reader.num_cols() + 1; //We add a starting dummy empty column
+  const Counter combinations = binom_coeff::cumulative_binomial_coefficient(n, k);
+  if(combinations == BINOMIAL_OVERFLOW ||
+     gaps >= (Counter)numeric_limits<Counter>::digits ||
+     combinations > (MAX_COUNTER >> gaps)) {
+    cerr << "ERROR: too many combinations of the reads of a column (" << n << " reads, "
+         << gaps << " gaps and at most " << k << " corrections): "
+         << "use a lower max-coverage or error-rate" << endl;
+    exit(EXIT_FAILURE);
+  }
+  return combinations << gaps;
+}
 
-  vector<Column> input(num_cols);
-  vector<unsigned int> homo_cost(num_cols);
-  vector<unsigned int> k_j(num_cols);
-  vector<Column>::iterator input_iterator(input.begin());
-  vector<Counter> rows(num_cols * MAX_COVERAGE, 0);
 
-  do {
-      Counter count_major = 0;
-      Counter count_minor = 0;
-      Counter count_gaps = 0;
+//Maximum coverage, k, gaps and number of columns of a read of the columns of
+//column_reader, and number of the masks of all the columns
+void measure_columns(ColumnReader1 &column_reader, Counter &MAX_COV, Counter &MAX_L,
+                     Counter &MAX_K, Counter &MAX_GAPS, unsigned long long &masks)
+{
+  //The rows of the active reads are kept sorted by read id
+  vector<pair<readid_t, Counter> > rows;
+  vector<pair<readid_t, Counter> > next_rows;
+  MAX_COV = 0;
+  MAX_L = 0;
+  MAX_K = 0;
+  MAX_GAPS = 0;
+  masks = 0;
 
-      Column &current_column = *input_iterator;
-      Column read_column;
+  column_reader.restart();
+  while(column_reader.has_next()) {
+    const Column &read_column = column_reader.get_next();
+    Counter count_not_gaps = 0;
+    Counter count_gaps = 0;
+
+    next_rows.clear();
+    vector<pair<readid_t, Counter> >::const_iterator irow = rows.begin();
+    for(unsigned int i = 0; i < read_column.size(); ++i) {
+      if(!read_column[i].is_gap()) {
+        if(read_column[i].get_allele_type() == Entry::MAJOR_ALLELE ||
+           read_column[i].get_allele_type() == Entry::MINOR_ALLELE) {
+          ++count_not_gaps;
+        } else {
+          cerr << "ERROR: read invalid entry of type: " << read_column[i].get_allele_type() << endl;
+          exit(EXIT_FAILURE);
+        }
+      } else {
+        ++count_gaps;
+      }
 
-      //XXX: Use current_column = column_read.get_next()
-      if(input_iterator == input.begin()) {
-        read_column.clear();
+      //Reads not in the current column are ended
+      while(irow != rows.end() && (*irow).first < read_column[i].get_read_id()) {
+        MAX_L = std::max(MAX_L, (*irow).second);
+        ++irow;
+      }
+      if(irow != rows.end() && (*irow).first == read_column[i].get_read_id()) {
+        next_rows.push_back(make_pair((*irow).first, (*irow).second + 1));
+        ++irow;
       } else {
-        read_column = column_reader.get_next();
+        next_rows.push_back(make_pair(read_column[i].get_read_id(), 1));
       }
+    }
+    for(; irow != rows.end(); ++irow) {
+      MAX_L = std::max(MAX_L, (*irow).second);
+    }
+    rows.swap(next_rows);
 
-      current_column.resize(read_column.size(), Entry(-1, Entry::BLANK, 0));
+    MAX_COV = std::max(static_cast<Counter>(read_column.size()), MAX_COV);
+    MAX_K = std::max(computeK(count_not_gaps), MAX_K);
+    MAX_GAPS = std::max(count_gaps, MAX_GAPS);
+    masks += count_combinations(count_not_gaps, computeK(count_not_gaps), count_gaps);
+  }
+  for(vector<pair<readid_t, Counter> >::const_iterator irow = rows.begin();
+      irow != rows.end();
+      ++irow) {
+    MAX_L = std::max(MAX_L, (*irow).second);
+  }
 
-      for(unsigned int i = 0; i < read_column.size(); ++i) {
-        current_column[i].set_read_id(read_column[i].get_read_id());
-        current_column[i].set_allele_type(read_column[i].get_allele_type());
-        current_column[i].set_phred_score(read_column[i].get_phred_score());
-        current_column[i].set_gap(read_column[i].is_gap());
+  MAX_L = std::max(MAX_L, static_cast<Counter>(2));
+}
 
-        if(!current_column[i].is_gap()) {
-          if(current_column[i].get_allele_type() == Entry::MAJOR_ALLELE) {
-            ++count_major;
-          } else if (current_column[i].get_allele_type() == Entry::MINOR_ALLELE) {
-            ++count_minor;
-          } else {
-            cerr << "ERROR: read invalid entry of type: " << current_column[i].get_allele_type() << endl;
-            exit(EXIT_FAILURE);
-          }
-        } else {
-          ++count_gaps;
-        }
 
-        ++rows[current_column[i].get_read_id()];
-      }
 
-      //sufficient condition to check the feasibility for the homozygous transformation
-      homo_cost[input_iterator - input.begin()] = std::min(count_major, count_minor);
+//Solve the block of a single column j without the DP (and without allocating
+//memory). The empty mask of j costs nothing, as j is the first heterozygous
+//column of its block: the DP keeps j homozygous only if its homozygous
+//correction (chosen as in insert_col_and_update) is feasible and costs nothing
+//too, since the heterozygous case must be strictly cheaper. The haplotypes
+//are the ones of reconstruct_haplotypes, and the maximum parameters the ones
+//of measure_columns.
+void dp_single_column(const options_t &options, ColumnReader1 &column_reader,
+                      vector<bool> &haplotype1, vector<bool> &haplotype2, Counter &step_global,
+                      const Cost &OPT_global, Counter &MAX_COV_global, Counter &MAX_L_global,
+                      Counter &MAX_K_global, Counter &MAX_GAPS_global)
+{
+  column_reader.restart();
+  column_reader.has_next();
+  const Column &column = column_reader.get_next();
+
+  Counter count_gaps = 0;
+  Counter count_major = 0;
+  Cost weight_major = 0;
+  Counter count_minor = 0;
+  Cost weight_minor = 0;
+  for(unsigned int i = 0; i < column.size(); ++i) {
+    const unsigned int phred_score = (options.unweighted)? 1 : column[i].get_phred_score();
+    if(column[i].is_gap()) {
+      ++count_gaps;
+    } else if(column[i].get_allele_type() == Entry::MINOR_ALLELE) {
+      ++count_minor;
+      weight_minor += phred_score;
+    } else if(column[i].get_allele_type() == Entry::MAJOR_ALLELE) {
+      ++count_major;
+      weight_major += phred_score;
+    } else {
+      cerr << "ERROR: read invalid entry of type: " << column[i].get_allele_type() << endl;
+      exit(EXIT_FAILURE);
+    }
+  }
 
-      if(options.all_heterozygous) {
-        homo_cost[input_iterator - input.begin()] = MAX_COVERAGE + 1;
+  const Counter k = computeK(count_minor + count_major);
+  //The DP would not index the masks of the column
+  count_combinations(count_minor + count_major, k, count_gaps);
+
+  MAX_COV_global = max(MAX_COV_global, static_cast<Counter>(column.size()));
+  MAX_L_global = max(MAX_L_global, static_cast<Counter>(2));
+  MAX_K_global = max(MAX_K_global, k);
+  MAX_GAPS_global = max(MAX_GAPS_global, count_gaps);
+
+  Cost homo_weight = Cost::INFTY;
+  bool kind_homozygous = false;
+  if(count_minor <= k && weight_minor < homo_weight) {
+    homo_weight = weight_minor;
+    kind_homozygous = true;
+  }
+  if(count_major <= k && weight_major < homo_weight) {
+    homo_weight = weight_major;
+    kind_homozygous = false;
+  }
+
+  if(!options.all_heterozygous && homo_weight == Cost(0)) {
+    haplotype1[0] = !kind_homozygous;
+    haplotype2[0] = !kind_homozygous;
+  } else {
+    haplotype1[0] = true;
+    haplotype2[0] = false;
+  }
+
+  //The optimal cost of the block is zero
+  step_global++;
+  if (step_global % 500 == 0) {
+    INFO(".:: Step: " << step_global << "  ==>  OPT: " << OPT_global);
+  }
+}
+
+
+
+//Solve without the DP (and without allocating memory) a block whose columns
+//have exactly two reads, with opposite alleles and positive weights (hence
+//all the columns that are not jumped as homozygous, if the coverage is at
+//most 2). The reads are intervals of columns, at most two of which overlap,
+//hence all the columns are heterozygous with the empty mask at cost zero,
+//while a homozygous column costs the weight of one of its reads. As in
+//reconstruct_haplotypes, haplotype1 has the minor allele in the first column
+//of each block of the DP (a column sharing no read with the previous one),
+//and the reads keep their haplotype along the following columns.
+//Return false (leaving the counters unchanged) if the block is not of this
+//shape, or if a read is not an interval (a read that is not in the previous
+//column must come after all the reads seen before).
+bool dp_two_reads(const options_t &options, ColumnReader1 &column_reader,
+                  vector<bool> &haplotype1, vector<bool> &haplotype2, Counter &step_global,
+                  const Cost &OPT_global, Counter &MAX_COV_global, Counter &MAX_L_global,
+                  Counter &MAX_K_global, Counter &MAX_GAPS_global)
+{
+  //The two reads of the previous column, the column of their first entry,
+  //and the read with the allele of haplotype1
+  readid_t reads[2] = { -1, -1 };
+  Counter starts[2] = { 0, 0 };
+  readid_t read1 = -1;
+  readid_t max_read = -1;
+  Counter MAX_L = 2;
+
+  Counter j = 0;
+  column_reader.restart();
+  while(column_reader.has_next()) {
+    const Column &column = column_reader.get_next();
+    if(column.size() != 2 || column[0].is_gap() || column[1].is_gap() ||
+       column[0].get_allele_type() == column[1].get_allele_type() ||
+       (!options.unweighted && (column[0].get_phred_score() == 0 || column[1].get_phred_score() == 0))) {
+      return false;
+    }
+
+    readid_t next_reads[2];
+    Counter next_starts[2];
+    bool shared = false;
+    for(unsigned int i = 0; i < 2; ++i) {
+      next_reads[i] = column[i].get_read_id();
+      if(next_reads[i] == reads[0] || next_reads[i] == reads[1]) {
+        next_starts[i] = starts[(next_reads[i] == reads[0]) ? 0 : 1];
+        shared = true;
+      } else if(next_reads[i] > max_read) {
+        next_starts[i] = j;
+      } else {
+        return false;
       }
+    }
+    for(unsigned int i = 0; i < 2; ++i) {
+      if(reads[i] != -1 && reads[i] != next_reads[0] && reads[i] != next_reads[1]) {
+        MAX_L = max(MAX_L, j - starts[i]);
+      }
+    }
+    max_read = max(max_read, next_reads[1]);
+
+    //A read of the previous column that is not in haplotype1 leaves the
+    //other read of j in haplotype1
+    if(!shared) {
+      read1 = (column[0].get_allele_type() == Entry::MINOR_ALLELE) ? next_reads[0] : next_reads[1];
+    } else if(read1 != next_reads[0] && read1 != next_reads[1]) {
+      read1 = (next_reads[0] == reads[0] || next_reads[0] == reads[1]) ? next_reads[1] : next_reads[0];
+    }
+    const Entry &entry1 = column[(read1 == next_reads[0]) ? 0 : 1];
+    haplotype1[j] = (entry1.get_allele_type() == Entry::MINOR_ALLELE);
+    haplotype2[j] = !haplotype1[j];
 
-      k_j[input_iterator - input.begin()] = computeK(count_minor + count_major);
+    for(unsigned int i = 0; i < 2; ++i) {
+      reads[i] = next_reads[i];
+      starts[i] = next_starts[i];
+    }
+    ++j;
+  }
+  for(unsigned int i = 0; i < 2; ++i) {
+    MAX_L = max(MAX_L, j - starts[i]);
+  }
 
-      MAX_COV = std::max(static_cast<Counter>((*input_iterator).size()), MAX_COV);
-      MAX_K = std::max(k_j[input_iterator - input.begin()], MAX_K);
-      MAX_GAPS = std::max(count_gaps, MAX_GAPS);
+  MAX_COV_global = max(MAX_COV_global, static_cast<Counter>(2));
+  MAX_L_global = max(MAX_L_global, MAX_L);
+  MAX_K_global = max(MAX_K_global, computeK(2));
+  MAX_GAPS_global = max(MAX_GAPS_global, static_cast<Counter>(0));
+
+  //The optimal cost of the block is zero
+  for(Counter step = 0; step < j; ++step) {
+    step_global++;
+    if (step_global % 500 == 0) {
+      INFO(".:: Step: " << step_global << "  ==>  OPT: " << OPT_global);
+    }
+  }
+  return true;
+}
 
-      ++input_iterator;
-  } while((input_iterator != input.end()) & column_reader.has_next());
 
-  MAX_L = *max_element(rows.begin(), rows.end());
-  MAX_L = std::max(MAX_L, static_cast<Counter>(2));
 
+//The columns are read twice and only a window of MAX_L columns is kept in
+//memory, hence it can be used on the streamed unique block.
+void computeInputParams(Counter &num_cols, Counter &MAX_COV, Counter &MAX_L,
+                        Counter &MAX_K, Counter &MAX_GAPS, SolverContext &context,
+                        ColumnReader1 &column_reader,
+                        const options_t &options)
+{
+  vector<Counter> &sum_successive_L = context.sum_successive_L;
+  vector<vector<Counter> > &scheme_backtrace = context.scheme_backtrace;
+
+  num_cols = column_reader.num_cols() + 1; //We add a starting dummy empty column
+
+  //First pass: maximum coverage, k, gaps and number of columns of a read
+  unsigned long long masks = 0;
+  measure_columns(column_reader, MAX_COV, MAX_L, MAX_K, MAX_GAPS, masks);
+
+  //Second pass: for each column i and each of the following columns i + y
+  //(with y < MAX_L) compute the number of combinations of the common reads.
+  //The columns are kept in a ring buffer of MAX_L columns.
   Counter MAX_CONS_HOMO = 0;    //The maximum number of consecutive homozigous columns
 
+  vector<Column> &window = context.window;
+  context.resize(window, MAX_L);
+  vector<Counter> homo_cost(MAX_L);
+  vector<Counter> k_j(MAX_L);
+  vector<bool> flag(MAX_L);
+  vector<Counter> current_cons_homo(MAX_L);   //The maximum number of consecutive homozigous columns assuming i the first
+
+  sum_successive_L.clear();
   sum_successive_L.resize(MAX_L, 0);
-  scheme_backtrace.clear();
-  scheme_backtrace.resize(num_cols);
-  for(unsigned int i = 0; i < input.size(); i++)
-    {
-      unsigned int y = 1;
-      unsigned int k_temp = k_j[i];
-      unsigned int current_cons_homo = 0;   //The maximum number of consecutive homozigous columns assuming i the first
-      bool flag = true;
-      scheme_backtrace[i].push_back(0);
+  context.resize(scheme_backtrace, num_cols);
+  for(Counter c = 0; c < num_cols; ++c) {
+    scheme_backtrace[c].clear();
+  }
 
-      while(y < MAX_L && (i + y) < input.size())
-        {
-          unsigned int common_gaps = 0;
-          Counter active_common = compute_active_common(input[i], input[i + y], common_gaps);
+  column_reader.restart();
+  for(Counter c = 0; c < num_cols; ++c) {
+    const Counter ic = c % MAX_L;
+
+    //The column leaving the window
+    if(c >= MAX_L) {
+      MAX_CONS_HOMO = std::max(MAX_CONS_HOMO, current_cons_homo[ic]);
+    }
+
+    //XXX: Use current_column = column_read.get_next()
+    if(c == 0) {
+      window[ic].clear();
+    } else {
+      column_reader.has_next();
+      window[ic] = column_reader.get_next();
+    }
+
+    Counter count_major = 0;
+    Counter count_minor = 0;
+    for(unsigned int i = 0; i < window[ic].size(); ++i) {
+      if(!window[ic][i].is_gap()) {
+        if(window[ic][i].get_allele_type() == Entry::MAJOR_ALLELE) {
+          ++count_major;
+        } else {
+          ++count_minor;
+        }
+      }
+    }
 
-          //XXX: Add MAX_COMB_K and MAX_COMB_GAPS??
+    //sufficient condition to check the feasibility for the homozygous transformation
+    homo_cost[ic] = std::min(count_major, count_minor);
 
-          Counter result = 0;
-          result = binom_coeff::cumulative_binomial_coefficient(active_common - common_gaps, k_temp) << common_gaps;
+    if(options.all_heterozygous) {
+      homo_cost[ic] = MAX_COVERAGE + 1;
+    }
 
-          // if(active_common != common_gaps) {
-          //   result = binom_coeff::cumulative_binomial_coefficient(active_common - common_gaps, k_temp) << common_gaps;
-          // } else {
-          //   result = binom_coeff::cumulative_binomial_coefficient(common_gaps, common_gaps);
-          // }
+    k_j[ic] = computeK(count_minor + count_major);
+    flag[ic] = true;
+    current_cons_homo[ic] = 0;
+    scheme_backtrace[c].push_back(0);
 
-          sum_successive_L[y] = max(sum_successive_L[y], result);
+    //The new column is the y-th successive of the previous columns i
+    for(Counter y = std::min(c, MAX_L - 1); y >= 1; --y) {
+      const Counter i = c - y;
+      const Counter ii = i % MAX_L;
 
-          if(flag) {
-            //XXX: Can I add && active_common != 0?
-            if( (homo_cost[i + y] <= k_j[i + y]) && active_common != 0) {
-              ++current_cons_homo;
-              scheme_backtrace[i].push_back(result);
-            } else {
-              flag = false;
-              scheme_backtrace[i].push_back(result);
-            }
-          }
+      unsigned int common_gaps = 0;
+      Counter active_common = compute_active_common(window[ii], window[ic], common_gaps);
 
-          y++;
-        }
+      //XXX: Add MAX_COMB_K and MAX_COMB_GAPS??
 
-      MAX_CONS_HOMO = std::max(MAX_CONS_HOMO, current_cons_homo);
+      const Counter result = count_combinations(active_common - common_gaps, k_j[ii], common_gaps);
+
+      sum_successive_L[y] = max(sum_successive_L[y], result);
+
+      if(flag[ii]) {
+        //XXX: Can I add && active_common != 0?
+        if( (homo_cost[ic] <= k_j[ic]) && active_common != 0) {
+          ++current_cons_homo[ii];
+          scheme_backtrace[i].push_back(result);
+        } else {
+          flag[ii] = false;
+          scheme_backtrace[i].push_back(result);
+        }
+      }
     }
+  }
+
+  for(Counter c = (num_cols > MAX_L) ? num_cols - MAX_L : 0; c < num_cols; ++c) {
+    MAX_CONS_HOMO = std::max(MAX_CONS_HOMO, current_cons_homo[c % MAX_L]);
+  }
 
   //+1 is necessary to count the first heterozygous column before the longest sequence of homozugouses
   //and another +1 to count the heterozygous column after that
@@ -1133,6 +2049,7 @@ void computeInputParams(Counter &num_cols, Counter &MAX_COV, Counter &MAX_L,
 
 
 //XXX: Can I leave parameter q and pass as parameter just one column of forw_indexer and back_indexer??????????
+template <typename BitColumn>
 void intersect(const Column &colQ, const Column &colJ, const Pointer &q,
                vector<vector<Pointer> > &forw_indexer, vector<vector<Pointer> > &back_indexer,
                vector<BitColumn> &pos_gaps, vector<Counter> &num_pos_gaps, const bool &q_is_back)
@@ -1183,6 +2100,7 @@ void intersect(const Column &colQ, const Column &colJ, const Pointer &q,
 }
 
 
+template <typename BitColumn>
 void represent_column(const Column &column, BitColumn &result, Counter &cov,
                       BitColumn &gaps_mask, Counter &num_gaps)
 {
@@ -1201,69 +2119,7 @@ void represent_column(const Column &column, BitColumn &result, Counter &cov,
 }
 
 
-void make_mask(BitColumn &mask, const BitColumn &mask_gaps, const unsigned int &cov,
-               const BitColumn &comb_gaps, const BitColumn &comb_no_gaps)
-{
-  mask.reset();
-  unsigned int i_no_gaps = 0;
-  unsigned int i_gaps = 0;
-
-  for(unsigned int i = 0; i < cov; ++i) {
-    // mask.set(i, (mask_gaps.test(i) && comb_gaps.test(i_gaps)) || (!mask_gaps.test(i) && comb_no_gaps.test(i_no_gaps)) );
-    // i_gaps += mask_gaps.test(i);
-    // i_no_gaps += !mask_gaps.test(i);
-    if(mask_gaps[i]) {
-      mask.set(i, comb_gaps[i_gaps++]);
-    } else {
-      mask.set(i, comb_no_gaps[i_no_gaps++]);
-    }
-  }
-}
-
-
-unsigned int compute_index_of(const BitColumn &mask, const unsigned int &cov, const unsigned int &num_gaps,
-                              const BitColumn &pos_gaps, Combinations &generator)
-{
-  BitColumn comb_gaps;
-  BitColumn comb_no_gaps;
-
-  unsigned int i_gaps = 0;
-  unsigned int i_no_gaps = 0;
-
-  for(unsigned int i = 0; i < cov; ++i) {
-    // comb_gaps.set(i_gaps, pos_gaps.test(i) && mask.test(i));
-    // comb_no_gaps.set(i_no_gaps, !pos_gaps.test(i) && mask.test(i));
-    // i_gaps += pos_gaps.test(i);
-    // i_no_gaps += !pos_gaps.test(i);
-    if(pos_gaps[i]) {
-      comb_gaps.set(i_gaps++, mask[i]);
-    } else {
-      comb_no_gaps.set(i_no_gaps++, mask[i]);
-    }
-  }
-
-  return (generator.cumulative_indexof(comb_no_gaps, cov - num_gaps) << num_gaps) | ((unsigned int) comb_gaps.to_ulong());
-  //  return generator.cumulative_indexof(comb_no_gaps, cov - num_gaps) +
-  //  ((unsigned int) comb_gaps.to_ulong()) * binom_coeff::binomial_coefficient(cov - num_gaps, k);
-}
-
-
-
-void cut(const BitColumn &in_col, BitColumn &cut_mask, const vector<Pointer> &indexer, Counter &active_pj)
-{
-  active_pj = 0;
-  cut_mask.reset();
-
-  const size_t isize= indexer.size();
-  const Pointer* iactive= &indexer[0];
-  while(active_pj < isize && *iactive != -1) {
-    cut_mask.set(active_pj, in_col[*iactive]);
-    ++active_pj;
-    ++iactive;
-  }
-}
-
-
+template <typename BitColumn>
 void extract_common_mask(const Column &column_q, const Pointer &q_pointer,
                          const Column &column_j, const BitColumn &mask_colj,
                          const vector<vector<Pointer> > &back_indexer,
@@ -1336,14 +2192,13 @@ void insert_col_and_update(vector<Column> &input, vector<Counter> &k_j, vector <
   unsigned int i = 0;
   for(i = 0; i < column.size(); i++)
     {
-      const readid_t column_read_id = column[i].get_read_id();
       const Entry::allele_t column_allele_type = column[i].get_allele_type();
       const unsigned int column_phred_score = (options.unweighted)? 1 : column[i].get_phred_score();
 
-      input[pointer][i].set_read_id(column_read_id);
-      input[pointer][i].set_allele_type(column_allele_type);
-      input[pointer][i].set_phred_score(column_phred_score);
-      input[pointer][i].set_gap(column[i].is_gap());
+      input[pointer][i] = column[i];
+      if(options.unweighted) {
+        input[pointer][i].set_phred_score(column_phred_score);
+      }
 
       if(!column[i].is_gap()) {
         if(column_allele_type == Entry::MINOR_ALLELE) {
@@ -1399,60 +2254,413 @@ void insert_col_and_update(vector<Column> &input, vector<Counter> &k_j, vector <
 
 
 
-void compute_weight_mask(const BitColumn &mask, const Column &column, Cost &weight_mask) {
-  BitColumn comb(mask);
-  weight_mask = 0;
-  int pos = 0;
-  //Column::const_iterator i_column = column.begin();
-  int temp = 0;
+//Flip read of column j in its mask, in the weight of the mask and (if the
+//kernel Bits does not gather them) in the projections of the mask on the
+//other columns of the window (from first to end, but j)
+template <typename BitColumn, typename Bits>
+void flip_read(const Counter &read, BitColumn &mask, Cost::cost_t &weight, const Column &column,
+               vector<MaskProjection<BitColumn> > &projections,
+               const Pointer &first, const Pointer &j, const Pointer &end)
+{
+  mask.flip(read);
+  if(mask[read]) {
+    weight += column[read].get_phred_score();
+  } else {
+    weight -= column[read].get_phred_score();
+  }
+  if(Bits::gathers) {
+    return;
+  }
+  for(Pointer p = first; p < j; ++p) {
+    projections[p].flip(read);
+  }
+  for(Pointer p = j + 1; p < end; ++p) {
+    projections[p].flip(read);
+  }
+}
+
+
+
+//Set the index of the projection of the mask of the lane (and of its
+//complement) on the i-th previous column, if it has few enough corrections
+template <typename BitColumn>
+void index_previous(const MaskProjection<BitColumn> &projection, const Counter &max_corrections,
+                    Combinations<BitColumn> &generator, MaskBatch &batch,
+                    const size_t &i, const unsigned int &lane)
+{
+  if(projection.corrections() <= max_corrections) {
+    batch.previous_index[(2 * i) * MaskBatch::LANES + lane] = projection.index(generator);
+    batch.previous_lanes[2 * i] |= 1U << lane;
+  }
+  if(projection.complement_corrections() <= max_corrections) {
+    batch.previous_index[(2 * i + 1) * MaskBatch::LANES + lane] = projection.complement_index(generator);
+    batch.previous_lanes[2 * i + 1] |= 1U << lane;
+  }
+}
+
+
+
+//Evaluate the masks of the range of column j, a batch at a time. With a
+//backtrace table the previsions for the successive columns are made in place
+//(the range is the only one), otherwise they are kept in the range.
+template <typename BitColumn, typename Bits>
+void evaluate_masks(const dp_step_t &data, MaskRange<BitColumn> &range,
+                    vector<MaskProjection<BitColumn> > &projections, MaskBatch &batch,
+                    BacktraceTable *backtrace_table)
+{
+  const Column &column = *data.column;
+  const vector<Counter> &no_gap_reads = *data.no_gap_reads;
+  const vector<Counter> &gap_reads = *data.gap_reads;
+  const Counter num_gaps = data.num_gaps;
+  const Pointer first_projection = data.first_projection;
+  const Pointer indexer_pointer = data.indexer_pointer;
+  const Pointer end_projection = data.end_projection;
+  const MaskBatch::relax_t relax = data.relax;
+  Combinations<BitColumn> &generator = range.generator;
 
-  while(comb.any())
+  BitColumn mask;
+  BitColumn comb_no_gaps;
+  BitColumn last_comb_no_gaps;
+  Counter last_comb_gaps(0);
+  Cost::cost_t weight_sum(0);
+  BitColumn lane_masks[MaskBatch::LANES];
+  typename MaskRange<BitColumn>::choice_t choice = { (Counter)-1, 0, false, false };
+
+  //A range that does not start from the first combination starts from the
+  //current one of the generator
+  bool started = (range.begin == 0);
+  if(started) {
+    generator.initialize_cumulative(no_gap_reads.size(), data.k);
+  } else {
+    generator.cumulative_combinationof(range.begin, no_gap_reads.size(), data.k, comb_no_gaps);
+    generator.cumulative_start_from(comb_no_gaps, no_gap_reads.size(), data.k);
+  }
+  Counter remaining = range.end - range.begin;
+
+  Counter comb_gaps_int = (unsigned int)(1 << num_gaps);
+  bool has_masks = true;
+  while(has_masks)
     {
-      temp = ffsl(comb.to_ulong());
-      pos += temp;
-      //i_column += temp - 1;
-      weight_mask += column[pos - 1].get_phred_score();
-      //weight_mask += *i_column.get_phred_score();
-      comb>>=(temp);
-      //++i_column;
+      //Generate the masks of the batch, with their weights and the
+      //indices of their projections
+      batch.size = 0;
+      unsigned int bounded_lanes = 0;
+      while(batch.size < MaskBatch::LANES)
+        {
+          if(comb_gaps_int == (unsigned int)(1 << num_gaps))
+            {
+              if(remaining == 0 || (started && !generator.has_next()))
+                {
+                  has_masks = false;
+                  break;
+                }
+              if(started) {
+                generator.next();
+              }
+              started = true;
+              --remaining;
+              generator.get_combination(comb_no_gaps);
+              TRACE("Combination of not gaps: " << column_to_string(comb_no_gaps, data.cov_j - num_gaps));
+
+              //The combinations are enumerated by size: if j makes no
+              //previsions, none of the remaining masks can be better than
+              //the best one when the least weight of this size cannot
+              if(batch.successive.empty() &&
+                 !(data.min_weight[comb_no_gaps.count()] + data.lower_bound < range.best)) {
+                has_masks = false;
+                break;
+              }
+
+              //Flip in the mask only the reads that change from the previous combination
+              const BitColumn changed_no_gaps = comb_no_gaps ^ last_comb_no_gaps;
+              for(size_t i = changed_no_gaps._Find_first(); i < changed_no_gaps.size(); i = changed_no_gaps._Find_next(i)) {
+                flip_read<BitColumn, Bits>(no_gap_reads[i], mask, weight_sum, column,
+                                           projections, first_projection, indexer_pointer, end_projection);
+              }
+              last_comb_no_gaps = comb_no_gaps;
+              comb_gaps_int = 0;
+            }
+
+          TRACE("Combination of gaps: " << column_to_string(BitColumn(comb_gaps_int), num_gaps));
+
+          const BitColumn changed_gaps(comb_gaps_int ^ last_comb_gaps);
+          for(size_t i = changed_gaps._Find_first(); i < changed_gaps.size(); i = changed_gaps._Find_next(i)) {
+            flip_read<BitColumn, Bits>(gap_reads[i], mask, weight_sum, column,
+                                       projections, first_projection, indexer_pointer, end_projection);
+          }
+          last_comb_gaps = comb_gaps_int;
+          if(Bits::gathers) {
+            for(Pointer p = indexer_pointer + 1; p < end_projection; ++p) {
+              projections[p].template gather<Bits>(mask);
+            }
+          }
+          ++comb_gaps_int;
+
+          TRACE("|--------");
+          TRACE("|== Mask: " << column_to_string(mask, data.cov_j));
+
+          const unsigned int lane = batch.size++;
+          lane_masks[lane] = mask;
+
+          //Compute the weight of the mask
+          if (data.unweighted) {
+            batch.weight[lane] = Cost((Cost::cost_t)mask.count());
+          } else {
+            batch.weight[lane] = Cost(weight_sum);
+          }
+
+          //The projection of the mask on each successive column
+          for(size_t i = 0; i < batch.successive.size(); ++i) {
+            batch.successive_index[i * MaskBatch::LANES + lane] =
+              projections[indexer_pointer + batch.successive[i].distance].index(generator);
+          }
+
+          //The lookups are pruned if the mask cannot be better than the
+          //best one, nor than the previsions at its projections
+          const Cost bound = batch.weight[lane] + data.lower_bound;
+          bool bounded = !(bound < range.best);
+          for(size_t i = 0; bounded && i < batch.successive.size(); ++i) {
+            const Counter index = batch.successive_index[i * MaskBatch::LANES + lane];
+            bounded = !(bound < ((backtrace_table != NULL) ? batch.successive[i].row[index]
+                                                           : range.kept(i, index)));
+          }
+          ++range.evaluated;
+          if(bounded) {
+            ++range.bounded;
+            bounded_lanes |= 1U << lane;
+            continue;
+          }
+
+          //The kernels that do not gather the projections keep them up to
+          //date mask after mask, hence their lookups are made here
+          if(!Bits::gathers) {
+            for(size_t i = 0; i < batch.previous.size(); ++i) {
+              const MaskBatch::neighbour_t &neighbour = batch.previous[i];
+              ++range.lookups;
+              index_previous(projections[indexer_pointer - neighbour.distance], neighbour.max_corrections,
+                             generator, batch, i, lane);
+            }
+          }
+        }
+
+      //Compute D[j, Bj] for all the masks of the batch: the minimum
+      //over the previous columns (the projection first, then its
+      //complement) and the third case
+      for(unsigned int lane = 0; lane < batch.size; ++lane) {
+        batch.cost[lane] = Cost::INFTY;
+        batch.choice[lane] = MaskBatch::NO_CHOICE;
+      }
+      for(size_t i = 0; i < batch.previous.size(); ++i) {
+        const MaskBatch::neighbour_t &neighbour = batch.previous[i];
+        //The gathering kernels project the mask on the previous column
+        //only if the least lookup in it can be less than the ones before
+        //it (the relax keeps the first minimum)
+        if(Bits::gathers) {
+          MaskProjection<BitColumn> &projection = projections[indexer_pointer - neighbour.distance];
+          for(unsigned int lane = 0; lane < batch.size; ++lane) {
+            if(bounded_lanes & (1U << lane)) {
+              continue;
+            }
+            ++range.lookups;
+            if(!(batch.weight[lane] + neighbour.least < batch.cost[lane])) {
+              ++range.bounded_lookups;
+              continue;
+            }
+            projection.template gather<Bits>(lane_masks[lane]);
+            index_previous(projection, neighbour.max_corrections, generator, batch, i, lane);
+          }
+        }
+        for(unsigned int complement = 0; complement <= 1; ++complement) {
+          relax(neighbour.row, &batch.previous_index[(2 * i + complement) * MaskBatch::LANES],
+                batch.previous_lanes[2 * i + complement], batch.weight, neighbour.cumulative_homo,
+                batch.cost, batch.choice, 1 + 2 * i + complement);
+          batch.previous_lanes[2 * i + complement] = 0;
+        }
+      }
+      if(data.new_block) {
+        relax(data.new_block_OPT, MaskBatch::ZERO_INDICES, ((1U << batch.size) - 1) & ~bounded_lanes,
+              batch.weight, data.new_block_homo, batch.cost, batch.choice, 1 + 2 * batch.previous.size());
+      }
+
+      //Make the previsions for the successive columns and keep the best
+      //mask, mask after mask
+      for(unsigned int lane = 0; lane < batch.size; ++lane)
+        {
+          const Cost current_cost = batch.cost[lane];
+          const unsigned int lane_choice = batch.choice[lane];
+          if(lane_choice != MaskBatch::NO_CHOICE) {
+            range.solution_existence = true;
+            if(lane_choice == 1 + 2 * batch.previous.size()) {
+              choice.jump = data.new_block_jump;
+              choice.index = 0;
+              choice.haplotypes = false;
+              choice.new_block = true;
+              TRACE("<<>> Third case of recursion - First heterozigous of new block");
+            } else {
+              const Counter q = batch.previous[(lane_choice - 1) / 2].distance;
+              const bool complement = ((lane_choice - 1) % 2 == 1);
+              choice.jump = q;
+              choice.index = batch.previous_index[(lane_choice - 1) * MaskBatch::LANES + lane];
+              choice.haplotypes = (data.backtrace->get_haplotypes(data.step - q, q, choice.index) != complement);
+              choice.new_block = false;
+              TRACE("---->> the previous equal heterozigous is " << (data.step - q)
+                    << "  -- its index: " << choice.index);
+            }
+          }
+          TRACE("-->> Best current cost (D[j, C'j]): "<< current_cost);
+
+          for(size_t i = 0; i < batch.successive.size(); ++i) {
+            const Counter index = batch.successive_index[i * MaskBatch::LANES + lane];
+            TRACE("-->> Successive column: " << (data.step + batch.successive[i].distance)
+                  << " -- Prevision cost: " << current_cost
+                  << " -- Index of the common elements:  " << index);
+            if(backtrace_table == NULL) {
+              range.keep(i, index, current_cost, choice);
+              continue;
+            }
+            Cost& temp = batch.successive[i].row[index];
+            if(current_cost < temp) {
+              temp = current_cost;
+
+              backtrace_table->set(data.step, batch.successive[i].distance, index, choice.jump, choice.index,
+                                   choice.haplotypes, choice.new_block);
+            }
+          }
+
+          if(current_cost < range.best) {
+            range.best = current_cost;
+            range.best_choice = choice;
+            range.best_mask = lane_masks[lane];
+          }
+        }
+    }
+}
+
+
+//Length of the segments of the DP in low-memory mode. A checkpoint takes at
+//most the memory C of the prevision table: with n columns taking B bytes of
+//backtrace in all, segments of n * sqrt(C / B) columns minimize the memory of
+//the checkpoints and of the backtrace of a segment (2 * sqrt(B * C), which
+//is less than B only if B > 4 * C).
+Counter segment_length(const Counter &num_col, const size_t &checkpoint_memory,
+                       const vector<vector<Counter> > &scheme_backtrace,
+                       const unsigned int &entry_bits)
+{
+  double backtrace_memory = 0.0;
+  for(Counter j = 0; j < scheme_backtrace.size(); ++j) {
+    for(Counter q = 0; q < scheme_backtrace[j].size(); ++q) {
+      backtrace_memory += scheme_backtrace[j][q];
     }
+  }
+  backtrace_memory *= entry_bits / 8.0;
+
+  if(backtrace_memory <= 4.0 * checkpoint_memory) {
+    return num_col;
+  }
+  const double length = ceil(num_col * sqrt(checkpoint_memory / backtrace_memory));
+  return max((Counter)1, (Counter)min(length, (double)num_col));
 }
 
 
-void reconstruct_haplotypes(const vector<vector<vector<Backtrace1> > > &backtrace_table1,
-                            const vector<vector<vector<bool> > > &backtrace_table2_haplotypes,
-                            const vector<vector<vector<bool> > > &backtrace_table2_new_block,
+
+void save_checkpoint(dp_checkpoint_t &checkpoint, const Counter &step,
+                     const vector<Column> &input, const Pointer &input_pointer,
+                     const vector<Counter> &k_j, const vector<Counter> &homo_cost,
+                     const vector<Cost> &homo_weight, const PrevisionTable &prevision,
+                     const Pointer &prevision_pointer, const vector<Cost> &OPT, const Pointer &OPT_pointer,
+                     const ColumnReader1 &column_reader, const BacktraceTable &backtrace_table,
+                     const vector<vector<Counter> > &scheme_backtrace, const Counter &MAX_L)
+{
+  checkpoint.step = step;
+  checkpoint.input = input;
+  checkpoint.input_pointer = input_pointer;
+  checkpoint.k_j = k_j;
+  checkpoint.homo_cost = homo_cost;
+  checkpoint.homo_weight = homo_weight;
+  prevision.save(checkpoint.prevision);
+  checkpoint.prevision_pointer = prevision_pointer;
+  checkpoint.OPT = OPT;
+  checkpoint.OPT_pointer = OPT_pointer;
+  column_reader.save_position(checkpoint.reader);
+
+  //The following steps look back at most MAX_L - 1 columns
+  const Counter first = (step + 2 > MAX_L) ? step + 2 - MAX_L : 0;
+  checkpoint.backtrace = BacktraceTable(scheme_backtrace, MAX_L,
+                                        BacktraceTable::max_row_size(scheme_backtrace),
+                                        first, step + 1);
+  checkpoint.backtrace.copy_columns(backtrace_table);
+}
+
+
+
+void restore_checkpoint(const dp_checkpoint_t &checkpoint, Counter &step,
+                        vector<Column> &input, Pointer &input_pointer,
+                        vector<Counter> &k_j, vector<Counter> &homo_cost,
+                        vector<Cost> &homo_weight, PrevisionTable &prevision,
+                        Pointer &prevision_pointer, vector<Cost> &OPT, Pointer &OPT_pointer,
+                        ColumnReader1 &column_reader)
+{
+  step = checkpoint.step;
+  input = checkpoint.input;
+  input_pointer = checkpoint.input_pointer;
+  k_j = checkpoint.k_j;
+  homo_cost = checkpoint.homo_cost;
+  homo_weight = checkpoint.homo_weight;
+  prevision.restore(checkpoint.prevision);
+  prevision_pointer = checkpoint.prevision_pointer;
+  OPT = checkpoint.OPT;
+  OPT_pointer = checkpoint.OPT_pointer;
+  column_reader.restore_position(checkpoint.reader);
+}
+
+
+
+void reconstruct_haplotypes(const BacktraceTable &backtrace_table,
+                            haplotype_walk_t &walk,
                             const vector<bool> &is_homozygous,
                             const vector<bool> &homo_haplotypes,
                             const vector<Backtrace1> &best_heterozygous1,
                             const vector<bool> &best_heterozygous2_haplotypes,
                             const vector<bool> &best_heterozygous2_new_block,
                             vector<bool> &haplotype1, vector<bool> &haplotype2) {
-  Counter col = backtrace_table1.size() - 1;
+  Counter &col = walk.col;
 
-  haplotype1.resize(col);
-  haplotype2.resize(col);
+  haplotype1.resize(is_homozygous.size() - 1);
+  haplotype2.resize(is_homozygous.size() - 1);
 
   while(col > 0) {
-    while(is_homozygous[col]) {
-      if(homo_haplotypes[col]) {
-        haplotype1[col - 1] = false;
-        haplotype2[col - 1] = false;
-      } else {
-        haplotype1[col - 1] = true;
-        haplotype2[col - 1] = true;
+    if(!walk.in_block) {
+      while(is_homozygous[col]) {
+        if(homo_haplotypes[col]) {
+          haplotype1[col - 1] = false;
+          haplotype2[col - 1] = false;
+        } else {
+          haplotype1[col - 1] = true;
+          haplotype2[col - 1] = true;
+        }
+
+        --col;
       }
 
-      --col;
+      walk.back1 = best_heterozygous1[col];
+      walk.back2_haplotypes = best_heterozygous2_haplotypes[col];
+      walk.back2_new_block = best_heterozygous2_new_block[col];
+      walk.in_block = col > 0;
     }
 
-    Backtrace1 back1 = best_heterozygous1[col];
-    bool back2_haplotypes = best_heterozygous2_haplotypes[col];
-    bool back2_new_block = best_heterozygous2_new_block[col];
-    bool flag = col > 0;
+    while (walk.in_block) {
+      if(walk.pending) {
+        //The backtrace of the column is in a previous segment
+        if(col < backtrace_table.first_column()) {
+          return;
+        }
+        walk.back2_haplotypes = backtrace_table.get_haplotypes(col, walk.back1.jump, walk.back1.index);
+        walk.back2_new_block = backtrace_table.get_new_block(col, walk.back1.jump, walk.back1.index);
+        walk.back1 = backtrace_table.get(col, walk.back1.jump, walk.back1.index);
+        walk.pending = false;
+      }
 
-    while (flag) {
-      if(back2_haplotypes) {
+      if(walk.back2_haplotypes) {
         haplotype1[col - 1] = false;
         haplotype2[col - 1] = true;
       } else {
@@ -1460,7 +2668,7 @@ void reconstruct_haplotypes(const vector<vector<vector<Backtrace1> > > &backtrac
         haplotype2[col - 1] = false;
       }
 
-      for(int i = 0; i < (back1.jump - 1); i++) {
+      for(int i = 0; i < (walk.back1.jump - 1); i++) {
         --col;
         if(homo_haplotypes[col]) {
           haplotype1[col - 1] = false;
@@ -1473,13 +2681,10 @@ void reconstruct_haplotypes(const vector<vector<vector<Backtrace1> > > &backtrac
 
       --col;
 
-      if(back2_new_block || col == 0) {
-        flag = false;
+      if(walk.back2_new_block || col == 0) {
+        walk.in_block = false;
       } else {
-        flag = true;
-        back2_haplotypes = backtrace_table2_haplotypes[col][back1.jump][back1.index];
-        back2_new_block = backtrace_table2_new_block[col][back1.jump][back1.index];
-        back1 = backtrace_table1[col][back1.jump][back1.index];
+        walk.pending = true;
       }
 
     }
@@ -1488,111 +2693,148 @@ void reconstruct_haplotypes(const vector<vector<vector<Backtrace1> > > &backtrac
 
 
 
-Counter computeK(const Counter &cov, const double &alpha, const double &error_rate)
+//The k of each coverage up to cov
+static vector<Counter> compute_ks(const Counter &cov, const double &alpha, const double &error_rate)
 {
-  static bool computed = false;
-  static vector<Counter> ks(cov + 1, 0);
+  vector<Counter> ks(cov + 1, 0);
+  for(Counter i = 1; i < ks.size(); ++i) {
+    Counter k = 0;
+
+    double cumulative =  pow(1.0 - error_rate, i);
+    //The binomial coefficients of the deepest columns do not fit a Counter
+    double binomial = 1.0;
+
+    while(!(1.0 - cumulative <= alpha) && (k < i)) {
+      ++k;
+      binomial = binomial * (i - k + 1) / k;
+      cumulative += binomial * pow(error_rate, k) * pow(1.0 - error_rate, i - k);
+    }
 
-  if (!computed) {
-    for(Counter i = 1; i < ks.size(); ++i) {
-      Counter k = 0;
+    ks[i] = k;
+  }
+  return ks;
+}
 
-      double cumulative =  pow(1.0 - error_rate, i);
 
-      while(!(1.0 - cumulative <= alpha) && (k < i)) {
-        ++k;
-        cumulative += (double)binom_coeff::binomial_coefficient(i, k) * pow(error_rate, k) * pow(1.0 - error_rate, i - k);
-      }
 
-      ks[i] = k;
-    }
-    computed = true;
-  }
+Counter computeK(const Counter &cov, const double &alpha, const double &error_rate)
+{
+  //The table is built by the first call (with the largest coverage), only
+  //once even if the threads that solve the blocks make it concurrently
+  static const vector<Counter> ks = compute_ks(cov, alpha, error_rate);
 
   return ks[cov];
 }
 
 
 
+//The columns are read twice: the first time to map each read to the closest
+//haplotype (keeping only the distances of the reads covering the current
+//column), the second time to count the alleles of the reads mapped to each
+//haplotype.
 void add_xs(const vector<bool> &haplo1, const vector<bool> &haplo2,
             vector<char> &haplo1_out, vector<char> &haplo2_out,
             ColumnReader1 &column_reader, const options_t &options,
             Counter &XS1, Counter &XS2, Counter &MISMATCHES)
 {
-  column_reader.restart();
-
-  vector<vector<char> > reads_matrix;
-  vector<vector<unsigned int> > weights;
-  vector<int> starting_positions;
+  //Distances from the two haplotypes of the reads covering the current column,
+  //sorted by read id
+  struct read_distance_t {
+    readid_t read_id;
+    unsigned int distance1;
+    unsigned int distance2;
+  };
+  vector<read_distance_t> active_reads;
+  vector<read_distance_t> next_active_reads;
+  //True if the read is mapped to the first haplotype
+  vector<bool> mapping_haplo1;
 
-  vector<vector<char> > mapping_haplo1(column_reader.num_cols());
-  vector<vector<unsigned int> > weight_mapping_haplo1(column_reader.num_cols());
-  vector<vector<char> > mapping_haplo2(column_reader.num_cols());
-  vector<vector<unsigned int> > weight_mapping_haplo2(column_reader.num_cols());
+  unsigned int total_errors = 0;
 
-  int current_column = -1;
+  column_reader.restart();
+  Counter current_column = 0;
 
   while(column_reader.has_next()) {
-    vector<Entry> column = column_reader.get_next();
-
-    ++current_column;
+    const Column &column = column_reader.get_next();
 
+    next_active_reads.clear();
+    vector<read_distance_t>::const_iterator iread = active_reads.begin();
     for(unsigned int i = 0; i < column.size(); ++i) {
-      while(reads_matrix.size() <= (unsigned int)column[i].get_read_id()) {
-        reads_matrix.push_back(vector<char>(0));
-        weights.push_back(vector<unsigned int>(0));
-        starting_positions.push_back(-1);
-      }
+      const readid_t read_id = column[i].get_read_id();
 
-      if(reads_matrix[column[i].get_read_id()].size() == 0) {
-        starting_positions[column[i].get_read_id()] = current_column;
+      //Reads not in the current column are ended
+      for(; iread != active_reads.end() && (*iread).read_id < read_id; ++iread) {
+        mapping_haplo1[(*iread).read_id] = (map_fragment((*iread).distance1, (*iread).distance2, total_errors) == 1);
       }
 
-      if(!column[i].is_gap()) {
-        if(column[i].get_allele_type() == Entry::MINOR_ALLELE) {
-          reads_matrix[column[i].get_read_id()].push_back('1');
-        } else {
-          reads_matrix[column[i].get_read_id()].push_back('0');
-        }
-      } else {
-        reads_matrix[column[i].get_read_id()].push_back('-');
+      read_distance_t read = { read_id, 0, 0 };
+      if(iread != active_reads.end() && (*iread).read_id == read_id) {
+        read = *iread;
+        ++iread;
+      }
+      if(mapping_haplo1.size() <= (size_t)read_id) {
+        mapping_haplo1.resize(read_id + 1);
       }
 
-      if(options.unweighted) {
-        weights[column[i].get_read_id()].push_back(1);
-      } else {
-        weights[column[i].get_read_id()].push_back(column[i].get_phred_score());
+      const unsigned int weight = (options.unweighted) ? 1 : column[i].get_phred_score();
+      const bool is_minor = !column[i].is_gap() && (column[i].get_allele_type() == Entry::MINOR_ALLELE);
+      const bool is_major = !column[i].is_gap() && (column[i].get_allele_type() != Entry::MINOR_ALLELE);
+
+      if((haplo1[current_column]) ? !is_minor : !is_major) {
+        read.distance1 += weight;
       }
+      if((haplo2[current_column]) ? !is_minor : !is_major) {
+        read.distance2 += weight;
+      }
+
+      next_active_reads.push_back(read);
+    }
+    for(; iread != active_reads.end(); ++iread) {
+      mapping_haplo1[(*iread).read_id] = (map_fragment((*iread).distance1, (*iread).distance2, total_errors) == 1);
     }
+    active_reads.swap(next_active_reads);
 
+    ++current_column;
+  }
+  for(vector<read_distance_t>::const_iterator iread = active_reads.begin();
+      iread != active_reads.end();
+      ++iread) {
+    mapping_haplo1[(*iread).read_id] = (map_fragment((*iread).distance1, (*iread).distance2, total_errors) == 1);
   }
 
-  unsigned int total_errors = 0;
-
+  Counter count_X1 = 0;
+  Counter count_X2 = 0;
+  vector<int> counter1(2);
+  vector<int> counter2(2);
 
-  for(unsigned int read_id = 0; read_id < reads_matrix.size(); ++read_id) {
-    if(map_fragment(reads_matrix[read_id], weights[read_id], starting_positions[read_id],
-                    haplo1, haplo2, total_errors) == 1) {
+  column_reader.restart();
+  current_column = 0;
 
-      //Map read in haplo 1
-      for(unsigned col = 0; col < reads_matrix[read_id].size(); ++col) {
-        mapping_haplo1[col + starting_positions[read_id]].push_back(reads_matrix[read_id][col]);
-        weight_mapping_haplo1[col + starting_positions[read_id]].push_back(weights[read_id][col]);
-      }
+  while(column_reader.has_next()) {
+    const Column &column = column_reader.get_next();
 
-    } else {
+    fill(counter1.begin(), counter1.end(), 0);
+    fill(counter2.begin(), counter2.end(), 0);
 
-      //Map read in haplo 2
-      for(unsigned col = 0; col < reads_matrix[read_id].size(); ++col) {
-        mapping_haplo2[col + starting_positions[read_id]].push_back(reads_matrix[read_id][col]);
-        weight_mapping_haplo2[col + starting_positions[read_id]].push_back(weights[read_id][col]);
+    for(unsigned int i = 0; i < column.size(); ++i) {
+      if(!column[i].is_gap()) {
+        vector<int> &counter = (mapping_haplo1[column[i].get_read_id()]) ? counter1 : counter2;
+        const unsigned int weight = (options.unweighted) ? 1 : column[i].get_phred_score();
+        counter[(column[i].get_allele_type() == Entry::MINOR_ALLELE) ? 1 : 0] += weight;
       }
-
     }
+
+    make_haplo(haplo1[current_column], haplo2[current_column], counter1, counter2,
+               haplo1_out[current_column], haplo2_out[current_column], count_X1, count_X2, options);
+
+    ++current_column;
   }
 
-  make_haplo(haplo1, haplo2, mapping_haplo1, mapping_haplo2, weight_mapping_haplo1, weight_mapping_haplo2,
-             haplo1_out, haplo2_out, XS1, XS2, options);
+  XS1 += count_X1;
+  XS2 += count_X2;
+
+  DEBUG("INTRODUCED X's IN FIRST HAPLOTYPE:   " << count_X1);
+  DEBUG("INTRODUCED X's IN SECOND HAPLOTYPE:   " << count_X2);
 
   MISMATCHES += total_errors;
   DEBUG("TOTAL MISMATCHES DURING MAPPING:   " << total_errors);
@@ -1600,109 +2842,316 @@ void add_xs(const vector<bool> &haplo1, const vector<bool> &haplo2,
 
 
 
-int map_fragment(const vector<char> &read, const vector<unsigned int> &weights, const unsigned int offset,
-                 const vector<bool> &haplo1_in, const vector<bool> &haplo2_in, unsigned int &total_errors)
+int map_fragment(const unsigned int distance1, const unsigned int distance2, unsigned int &total_errors)
 {
-  unsigned int distance1 = 0;
-  unsigned int distance2 = 0;
+  if(distance1 <= distance2) {
+    total_errors += distance1;
+    return 1;
+  } else {
+    total_errors += distance2;
+    return 2;
+  }
+}
 
-  for(unsigned int col = 0; col < read.size(); ++col) {
-    if(haplo1_in[col + offset]) {
-      if(read[col] != '1') {
-        distance1 += weights[col];
-      }
+
+void make_haplo(const bool haplo1, const bool haplo2, const vector<int> &counter1, const vector<int> &counter2,
+                char &haplo_out1, char &haplo_out2, Counter &count_X1, Counter &count_X2,
+                const options_t &options) {
+  if(counter1[0] == counter1[1]) {
+    haplo_out1 = 'X';
+    ++count_X1;
+  } else {
+    if(haplo1) {
+      haplo_out1 = '1';
     } else {
-      if(read[col] != '0') {
-        distance1 += weights[col];
-      }
+      haplo_out1 = '0';
     }
+  }
 
-    if(haplo2_in[col + offset]) {
-      if(read[col] != '1') {
-        distance2 += weights[col];
-      }
+  if(counter2[0] == counter2[1]) {
+    haplo_out2 = 'X';
+    ++count_X2;
+  } else {
+    if(haplo2) {
+      haplo_out2 = '1';
     } else {
-      if(read[col] != '0') {
-        distance2 += weights[col];
-      }
+      haplo_out2 = '0';
     }
   }
 
-  if(distance1 <= distance2) {
-    total_errors += distance1;
-    return 1;
-  } else {
-    total_errors += distance2;
-    return 2;
+  if(options.all_heterozygous) {
+    if(haplo_out1 == 'X' && haplo_out2 != 'X') {
+      haplo_out1 = (haplo_out2 == '0')? '1' : '0';
+      --count_X1;
+    } else if (haplo_out1 != 'X' && haplo_out2 == 'X') {
+      haplo_out2 = (haplo_out1 == '0')? '1' : '0';
+      --count_X2;
+    }
   }
 }
 
 
-void make_haplo(const vector<bool> &haplo1, const vector<bool> &haplo2,
-                const vector<vector<char> > &mapping_haplo1, const vector<vector<char> > &mapping_haplo2,
-                const vector<vector<unsigned int> > &weight_mapping_haplo1, const vector<vector<unsigned int> > &weight_mapping_haplo2,
-                vector<char> &haplo_out1, vector<char> &haplo_out2, Counter &XS1, Counter &XS2,
-                const options_t &options) {
-  unsigned int count_X1 = 0;
-  unsigned int count_X2 = 0;
-  vector<int> counter1(2);
-  vector<int> counter2(2);
 
-  for(unsigned int col = 0; col < mapping_haplo1.size(); ++col) {
-    count_alleles(mapping_haplo1[col], weight_mapping_haplo1[col], counter1);
-    count_alleles(mapping_haplo2[col], weight_mapping_haplo2[col], counter2);
+void benchmark_parsing(const options_t &options)
+{
+  if(!options.alignment_filename.empty()) {
+    FragmentSet fragments;
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    load_alignments(options, fragments);
+    const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    INFO("alignment extraction: " << fragments.size() << " fragments, "
+         << fragments.entries.size() << " entries in " << elapsed.count() << " s");
+    return;
+  }
 
-    if(counter1[0] == counter1[1]) {
-      haplo_out1[col] = 'X';
-      ++count_X1;
-    } else {
-      if(haplo1[col]) {
-        haplo_out1[col] = '1';
-      } else {
-        haplo_out1[col] = '0';
-      }
+  for(int legacy = 1; legacy >= 0; --legacy) {
+    BlockReader blockreader(options.input_filename, MAX_COVERAGE, options.unweighted, options.unique,
+                            options.parse_threads);
+    if(legacy && (blockreader.is_binary() || blockreader.is_compressed())) {
+      continue;
+    }
+    Counter num_entries = 0;
+
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    const Counter num_fragments = blockreader.parse_all(legacy == 1, num_entries);
+    const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    const char *parser = "mapped parser: ";
+    if(legacy) {
+      parser = "getline/stringstream parser: ";
+    } else if(blockreader.is_binary()) {
+      parser = "binary loader: ";
+    } else if(blockreader.is_compressed()) {
+      parser = "gzip decompressor and parser: ";
+    } else if(options.parse_threads > 1) {
+      parser = "chunked parser: ";
     }
 
-    if(counter2[0] == counter2[1]) {
-      haplo_out2[col] = 'X';
-      ++count_X2;
-    } else {
-      if(haplo2[col]) {
-        haplo_out2[col] = '1';
-      } else {
-        haplo_out2[col] = '0';
+    const double megabytes = blockreader.input_size() / (1024.0 * 1024.0);
+    INFO(parser << num_fragments << " fragments, " << num_entries << " entries, "
+         << megabytes << " MB in " << elapsed.count() << " s ("
+         << ((elapsed.count() > 0.0) ? megabytes / elapsed.count() : 0.0) << " MB/s)");
+  }
+}
+
+
+
+//Rank the same random combinations of k out of n elements (as the DP ranks the
+//projections of the masks) with the table-driven and with the
+//element-by-element ranking, after checking that they agree
+template <typename BitColumn>
+static
+void benchmark_ranking_of(const unsigned int n, const unsigned int k)
+{
+  const unsigned int num_combinations = 1 << 16;
+  const unsigned int repetitions = 64;
+  vector<BitColumn> combinations(num_combinations);
+  unsigned int seed = 1;
+  for(unsigned int c = 0; c < num_combinations; ++c) {
+    while(combinations[c].count() < k) {
+      seed = seed * 1103515245 + 12345;
+      combinations[c].set((seed >> 16) % n);
+    }
+  }
+
+  //The ranks are meaningful only if the combinations can be counted
+  Combinations<BitColumn> generator;
+  const bool check = binom_coeff::cumulative_binomial_coefficient(n, k) != BINOMIAL_OVERFLOW;
+  for(unsigned int c = 0; check && c < num_combinations; ++c) {
+    if(generator.cumulative_indexof(combinations[c], n) !=
+       generator.cumulative_indexof_by_elements(combinations[c], n)) {
+      FATAL("the ranks of combination " << combinations[c] << " differ");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  unsigned int checksum[2] = { 0, 0 };
+  double nanoseconds[2];
+  for(int table = 0; table <= 1; ++table) {
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(unsigned int r = 0; r < repetitions; ++r) {
+      for(unsigned int c = 0; c < num_combinations; ++c) {
+        checksum[table] += table ?
+          generator.cumulative_indexof(combinations[c], n) :
+          generator.cumulative_indexof_by_elements(combinations[c], n);
       }
     }
+    const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    nanoseconds[table] = elapsed.count() * 1e9 / ((double)num_combinations * repetitions);
+  }
+  INFO(BitColumn().size() << "-bit columns, " << k << " out of " << n << " elements: "
+       << nanoseconds[0] << " ns by elements, " << nanoseconds[1] << " ns by tables"
+       << " (checksum " << checksum[1] << ")");
+}
 
-    if(options.all_heterozygous) {
-      if(haplo_out1[col] == 'X' && haplo_out2[col] != 'X') {
-        haplo_out1[col] = (haplo_out2[col] == '0')? '1' : '0';
-        --count_X1;
-      } else if (haplo_out1[col] != 'X' && haplo_out2[col] == 'X') {
-        haplo_out2[col] = (haplo_out1[col] == '0')? '1' : '0';
-        --count_X2;
+
+
+void benchmark_ranking()
+{
+  const unsigned int ks[] = { 1, 3, 5, 8 };
+  for(unsigned int i = 0; i < sizeof(ks) / sizeof(ks[0]); ++i) {
+    benchmark_ranking_of<bitset<32> >(16, ks[i]);
+    benchmark_ranking_of<bitset<32> >(30, ks[i]);
+    benchmark_ranking_of<bitset<64> >(64, ks[i]);
+    benchmark_ranking_of<bitset<MAX_COVERAGE> >(MAX_COVERAGE, ks[i]);
+  }
+}
+
+
+
+//Root of the set of r in the union-find forest parent (with path halving)
+static
+readid_t find_root(vector<readid_t> &parent, readid_t r)
+{
+  while(parent[r] != r) {
+    parent[r] = parent[parent[r]];
+    r = parent[r];
+  }
+  return r;
+}
+
+
+
+//Split the columns of columnreader into the connected components of the
+//graph on the reads where two reads are adjacent if both have an entry (not a
+//gap) in the same column. The columns of different components do not share
+//any read with an entry (gaps have no cost and they do not change k_j), hence
+//the components can be solved independently and the sum of their optima is
+//the optimum of the whole block.
+//The i-th component is a block made of the columns of index
+//component_columns[i] (in the order of columnreader), restricted to the
+//entries of its reads. No component is returned if there is only one.
+void split_components(ColumnReader1 &columnreader, vector<Block> &components,
+                      vector<vector<Counter> > &component_columns)
+{
+  components.clear();
+  component_columns.clear();
+
+  //The block of columnreader is kept in memory (it is not streamed), hence
+  //its columns are not copied
+  vector<const Column*> columns;
+  readid_t max_read_id = -1;
+  columnreader.restart();
+  while(columnreader.has_next()) {
+    columns.push_back(&columnreader.get_next());
+    for(Column::const_iterator ientry = columns.back()->begin();
+        ientry != columns.back()->end();
+        ++ientry) {
+      max_read_id = max(max_read_id, (*ientry).get_read_id());
+    }
+  }
+
+  //Union-find on the read ids
+  vector<readid_t> parent(max_read_id + 1);
+  for(readid_t r = 0; r <= max_read_id; ++r) {
+    parent[r] = r;
+  }
+
+  //Every column has at least one entry that is not a gap
+  vector<readid_t> column_root(columns.size(), -1);
+  for(size_t j = 0; j < columns.size(); ++j) {
+    for(Column::const_iterator ientry = columns[j]->begin();
+        ientry != columns[j]->end();
+        ++ientry) {
+      if((*ientry).is_gap()) {
+        continue;
+      }
+      const readid_t root = find_root(parent, (*ientry).get_read_id());
+      if(column_root[j] == -1) {
+        column_root[j] = root;
+      } else if(root != column_root[j]) {
+        parent[root] = column_root[j];
       }
     }
   }
 
-  XS1 += count_X1;
-  XS2 += count_X2;
+  //Components are numbered by their first column
+  vector<Counter> component_of(columns.size());
+  vector<Counter> component_of_root(max_read_id + 1, MAX_COUNTER);
+  Counter num_components = 0;
+  for(size_t j = 0; j < columns.size(); ++j) {
+    const readid_t root = find_root(parent, column_root[j]);
+    if(component_of_root[root] == MAX_COUNTER) {
+      component_of_root[root] = num_components++;
+    }
+    component_of[j] = component_of_root[root];
+  }
 
-  DEBUG("INTRODUCED X's IN FIRST HAPLOTYPE:   " << count_X1);
-  DEBUG("INTRODUCED X's IN SECOND HAPLOTYPE:   " << count_X2);
+  if(num_components <= 1) {
+    return;
+  }
+
+  //Reads that are gaps in all the columns belong to no component and
+  //they are dropped (they do not contribute to any cost)
+  components.resize(num_components);
+  component_columns.resize(num_components);
+  for(size_t j = 0; j < columns.size(); ++j) {
+    const Counter c = component_of[j];
+    component_columns[c].push_back(j);
+    components[c].push_back(Column());
+    Column &column = components[c].back();
+    column.reserve(columns[j]->size());
+    for(Column::const_iterator ientry = columns[j]->begin();
+        ientry != columns[j]->end();
+        ++ientry) {
+      if(component_of_root[find_root(parent, (*ientry).get_read_id())] == c) {
+        column.push_back(*ientry);
+      }
+    }
+  }
 }
 
 
-void count_alleles(const vector<char> &col, const vector<unsigned int> &weight_col,
-                   vector<int> &counter) {
-  counter[0] = 0;
-  counter[1] = 0;
 
-  for(unsigned int i = 0; i < col.size(); ++i) {
-    if(col[i] == '0') {
-      counter[0] += weight_col[i];
-    } else if(col[i] == '1') {
-      counter[1] += weight_col[i];
+void report_block_sizes(const string &name, const vector<Counter> &sizes)
+{
+  //Upper bounds of the classes of the distribution
+  const Counter bounds[] = { 1, 10, 100, 1000, MAX_COUNTER };
+  const char *labels[] = { "1", "2-10", "11-100", "101-1000", ">1000" };
+  const size_t num_classes = sizeof(bounds) / sizeof(bounds[0]);
+
+  vector<Counter> counts(num_classes, 0);
+  Counter max_size = 0;
+  double total = 0.0;
+  for(vector<Counter>::const_iterator isize = sizes.begin();
+      isize != sizes.end();
+      ++isize) {
+    size_t i = 0;
+    while(*isize > bounds[i]) {
+      ++i;
     }
+    ++counts[i];
+    max_size = max(max_size, *isize);
+    total += *isize;
+  }
+
+  ostringstream distribution;
+  for(size_t i = 0; i < num_classes; ++i) {
+    distribution << "  " << labels[i] << ": " << counts[i];
   }
+  INFO("Columns solved by dp per " << name << ":" << distribution.str()
+       << "  (max " << max_size << ", mean " << (sizes.empty() ? 0.0 : total / sizes.size()) << ")");
+}
+
+
+
+void load_alignments(const options_t &options, FragmentSet &fragments)
+{
+  vector<variant_t> variants;
+  load_variants(options.variant_filename, options.chromosome, variants);
+  INFO("Loaded " << variants.size() << " SNVs of '" << options.chromosome
+       << "' from '" << options.variant_filename << "'");
+
+  extraction_stats_t stats;
+  extract_fragments(options.alignment_filename, variants, options.chromosome,
+                    options.min_base_quality, options.min_read_quality,
+                    fragments, stats);
+  INFO("Alignments read: " << stats.alignments << ", used: " << stats.used_alignments
+       << ", discarded by flag: " << stats.filtered_by_flag
+       << ", without base qualities: " << stats.without_qualities
+       << ", below the read quality: " << stats.filtered_by_read_quality);
+  INFO("Bases at the SNVs discarded: " << stats.filtered_by_base_quality << " below the base quality, "
+       << stats.other_alleles << " with other alleles");
+  INFO("Fragments built: " << stats.fragments << " (" << stats.merged_mates << " from pairs of mates) with "
+       << stats.entries << " entries");
 }
@@ -0,0 +1,718 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#include "alignment_reader.h"
+#include "wif_parser.h"
+
+#include <string.h>
+#include <ctype.h>
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <queue>
+
+
+//BAM flags of the alignments that are not used
+#define FLAG_PAIRED 0x1
+#define FLAG_UNMAPPED 0x4
+#define FLAG_MATE_UNMAPPED 0x8
+#define FLAG_DISCARDED (0x4 | 0x100 | 0x200 | 0x400 | 0x800)
+
+//CIGAR operations (in the order of their BAM codes)
+#define CIGAR_OPERATIONS "MIDNSHP=X"
+#define CIGAR_MATCH 0
+#define CIGAR_INSERTION 1
+#define CIGAR_DELETION 2
+#define CIGAR_SKIP 3
+#define CIGAR_SOFT_CLIP 4
+#define CIGAR_EQUAL 7
+#define CIGAR_DIFF 8
+
+
+typedef std::pair<const char*, const char*> field_t;
+
+//Split the line [begin, end) at the tabs into at most max_fields fields
+static
+void split_fields(const char *begin, const char *end, std::vector<field_t> &fields,
+                  const size_t max_fields)
+{
+  fields.clear();
+  while(fields.size() < max_fields) {
+    const char *tab = static_cast<const char*>(memchr(begin, '\t', end - begin));
+    if(tab == NULL || fields.size() + 1 == max_fields) {
+      tab = end;
+    }
+    fields.push_back(field_t(begin, tab));
+    if(tab == end) {
+      break;
+    }
+    begin = tab + 1;
+  }
+}
+
+static inline
+std::string field_string(const field_t &field)
+{
+  return std::string(field.first, field.second);
+}
+
+static inline
+long field_to_long(const field_t &field)
+{
+  return strtol(std::string(field.first, field.second).c_str(), NULL, 10);
+}
+
+//Next line of a mapped file or of a compressed file
+static inline
+const char* next_input_line(const char *&cursor, const char *limit,
+                            CompressedInput *decompressor, const char *&line_end)
+{
+  return (decompressor != NULL)
+    ? decompressor->next_line(line_end)
+    : next_wif_line(cursor, limit, line_end);
+}
+
+static inline
+bool variant_before(const variant_t &a, const variant_t &b)
+{
+  return a.position < b.position;
+}
+
+static inline
+bool same_variant_position(const variant_t &a, const variant_t &b)
+{
+  return a.position == b.position;
+}
+
+template <typename T>
+static inline
+T read_value(const char *p)
+{
+  T value;
+  memcpy(&value, p, sizeof(T));
+  return value;
+}
+
+
+
+void load_variants(const std::string &filename, const std::string &chromosome,
+                   std::vector<variant_t> &variants)
+{
+  variants.clear();
+
+  MappedFile input;
+  if(!input.open(filename)) {
+    std::cerr << "ERROR: failing opening the variant file: " << filename << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  const char *cursor = input.data();
+  const char *limit = input.data() + input.size();
+  std::unique_ptr<CompressedInput> decompressor;
+  if(CompressedInput::has_magic(input.data(), input.size())) {
+    decompressor.reset(new CompressedInput(input.data(), input.size()));
+  }
+
+  //The format is given by the number of fields of the first variant
+  bool vcf = false;
+  bool first = true;
+  std::vector<field_t> fields;
+  const char *line_end = NULL;
+  const char *line = NULL;
+  while((line = next_input_line(cursor, limit, decompressor.get(), line_end)) != NULL) {
+    if(*line == '#') {
+      continue;
+    }
+    split_fields(line, line_end, fields, 6);
+    if(first) {
+      vcf = (fields.size() >= 5);
+      first = false;
+    }
+
+    field_t position = fields[0];
+    field_t ref = (fields.size() > 1) ? fields[1] : field_t(line_end, line_end);
+    field_t alt = (fields.size() > 2) ? fields[2] : field_t(line_end, line_end);
+    if(vcf) {
+      if(fields.size() < 5) {
+        std::cerr << "ERROR: VCF file not well formatted: " << filename << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      if(field_string(fields[0]) != chromosome) {
+        continue;
+      }
+      position = fields[1];
+      ref = fields[3];
+      alt = fields[4];
+    } else if(fields.size() < 3) {
+      std::cerr << "ERROR: variant file not well formatted: " << filename << std::endl;
+      exit(EXIT_FAILURE);
+    }
+
+    //Only SNVs are considered
+    if(ref.second - ref.first != 1 || alt.second - alt.first != 1) {
+      continue;
+    }
+    variant_t variant;
+    variant.position = field_to_long(position);
+    variant.ref = toupper(*ref.first);
+    variant.alt = toupper(*alt.first);
+    variants.push_back(variant);
+  }
+
+  //Only the first variant at each position is kept
+  std::stable_sort(variants.begin(), variants.end(), variant_before);
+  variants.erase(std::unique(variants.begin(), variants.end(), same_variant_position),
+                 variants.end());
+}
+
+
+
+AlignmentReader::AlignmentReader(const std::string &filename)
+  : filename(filename), bam(false)
+{
+  if(!input.open(filename)) {
+    std::cerr << "ERROR: failing opening the alignment file: " << filename << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  cursor = input.data();
+  limit = input.data() + input.size();
+
+  if(CompressedInput::has_magic(input.data(), input.size())) {
+    //A BAM file is a BGZF file starting with its own magic bytes
+    char magic[4];
+    decompressor.reset(new CompressedInput(input.data(), input.size()));
+    bam = (decompressor->read(magic, 4) == 4 && memcmp(magic, "BAM\1", 4) == 0);
+
+    //Start again from the beginning of the data
+    decompressor.reset();
+    decompressor.reset(new CompressedInput(input.data(), input.size()));
+    if(bam) {
+      read_bam_header();
+    }
+  }
+}
+
+
+
+bool AlignmentReader::next(alignment_t &alignment)
+{
+  return (bam) ? next_bam(alignment) : next_sam(alignment);
+}
+
+
+
+void AlignmentReader::parse_error(const std::string &message) const
+{
+  std::cerr << "ERROR: " << (bam ? "BAM" : "SAM") << " input file not well formatted ("
+            << message << "): " << filename << std::endl;
+  exit(EXIT_FAILURE);
+}
+
+
+
+bool AlignmentReader::next_sam(alignment_t &alignment)
+{
+  const char *line_end = NULL;
+  const char *line = NULL;
+  do {
+    line = next_input_line(cursor, limit, decompressor.get(), line_end);
+    if(line == NULL) {
+      return false;
+    }
+  } while(*line == '@');
+
+  //QNAME FLAG RNAME POS MAPQ CIGAR RNEXT PNEXT TLEN SEQ QUAL [TAGS]
+  std::vector<field_t> fields;
+  split_fields(line, line_end, fields, 12);
+  if(fields.size() < 11) {
+    parse_error("missing fields");
+  }
+
+  alignment.name = field_string(fields[0]);
+  alignment.flag = field_to_long(fields[1]);
+  alignment.reference = field_string(fields[2]);
+  alignment.position = field_to_long(fields[3]);
+  alignment.mapping_quality = field_to_long(fields[4]);
+
+  alignment.cigar.clear();
+  if(!(fields[5].second - fields[5].first == 1 && *fields[5].first == '*')) {
+    uint32_t length = 0;
+    for(const char *p = fields[5].first; p < fields[5].second; ++p) {
+      if(*p >= '0' && *p <= '9') {
+        length = length * 10 + (*p - '0');
+      } else {
+        const char *operation = strchr(CIGAR_OPERATIONS, *p);
+        if(operation == NULL || *p == '\0') {
+          parse_error("unknown CIGAR operation");
+        }
+        alignment.cigar.push_back(length << 4 | (operation - CIGAR_OPERATIONS));
+        length = 0;
+      }
+    }
+  }
+
+  alignment.mate_reference = field_string(fields[6]);
+  if(alignment.mate_reference == "=") {
+    alignment.mate_reference = alignment.reference;
+  }
+  alignment.mate_position = field_to_long(fields[7]);
+
+  alignment.sequence.clear();
+  if(!(fields[9].second - fields[9].first == 1 && *fields[9].first == '*')) {
+    alignment.sequence.assign(fields[9].first, fields[9].second);
+  }
+
+  alignment.qualities.clear();
+  if(!(fields[10].second - fields[10].first == 1 && *fields[10].first == '*')) {
+    for(const char *p = fields[10].first; p < fields[10].second; ++p) {
+      alignment.qualities.push_back(*p - 33);
+    }
+  }
+
+  return true;
+}
+
+
+
+void AlignmentReader::read_bytes(char *out, const size_t length)
+{
+  if(decompressor->read(out, length) != length) {
+    std::cerr << "ERROR: BAM input file truncated: " << filename << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+
+
+void AlignmentReader::read_bam_header()
+{
+  char buffer[4];
+  read_bytes(buffer, 4);
+
+  read_bytes(buffer, 4);
+  std::vector<char> text(read_value<int32_t>(buffer));
+  if(!text.empty()) {
+    read_bytes(&text[0], text.size());
+  }
+
+  read_bytes(buffer, 4);
+  const int32_t num_references = read_value<int32_t>(buffer);
+  for(int32_t i = 0; i < num_references; ++i) {
+    read_bytes(buffer, 4);
+    std::vector<char> name(read_value<int32_t>(buffer));
+    if(name.empty()) {
+      parse_error("empty reference name");
+    }
+    read_bytes(&name[0], name.size());
+    //The name is NUL-terminated
+    references.push_back(std::string(&name[0], name.size() - 1));
+    read_bytes(buffer, 4);
+  }
+}
+
+
+
+bool AlignmentReader::next_bam(alignment_t &alignment)
+{
+  char buffer[4];
+  const size_t header_read = decompressor->read(buffer, 4);
+  if(header_read == 0) {
+    return false;
+  }
+  if(header_read != 4) {
+    read_bytes(buffer, 4);
+  }
+  const int32_t block_size = read_value<int32_t>(buffer);
+  if(block_size < 32) {
+    parse_error("record too short");
+  }
+  record.resize(block_size);
+  read_bytes(&record[0], block_size);
+
+  const char *p = &record[0];
+  const char *end = p + block_size;
+  const int32_t reference_id = read_value<int32_t>(p);
+  const int32_t position = read_value<int32_t>(p + 4);
+  const uint8_t name_length = read_value<uint8_t>(p + 8);
+  alignment.mapping_quality = read_value<uint8_t>(p + 9);
+  const uint16_t num_operations = read_value<uint16_t>(p + 12);
+  alignment.flag = read_value<uint16_t>(p + 14);
+  const int32_t sequence_length = read_value<int32_t>(p + 16);
+  const int32_t mate_reference_id = read_value<int32_t>(p + 20);
+  const int32_t mate_position = read_value<int32_t>(p + 24);
+  p += 32;
+
+  if(name_length == 0 || sequence_length < 0
+     || end - p < name_length + 4 * num_operations + (sequence_length + 1) / 2 + sequence_length) {
+    parse_error("record too short");
+  }
+  if(reference_id < -1 || reference_id >= static_cast<int32_t>(references.size())
+     || mate_reference_id < -1 || mate_reference_id >= static_cast<int32_t>(references.size())) {
+    parse_error("unknown reference");
+  }
+
+  alignment.name.assign(p, name_length - 1);
+  p += name_length;
+
+  alignment.reference = (reference_id >= 0) ? references[reference_id] : "*";
+  alignment.position = position + 1;
+  alignment.mate_reference = (mate_reference_id >= 0) ? references[mate_reference_id] : "*";
+  alignment.mate_position = mate_position + 1;
+
+  alignment.cigar.resize(num_operations);
+  for(uint16_t i = 0; i < num_operations; ++i) {
+    alignment.cigar[i] = read_value<uint32_t>(p + 4 * i);
+  }
+  p += 4 * num_operations;
+
+  static const char *BASES = "=ACMGRSVTWYHKDBN";
+  alignment.sequence.resize(sequence_length);
+  for(int32_t i = 0; i < sequence_length; ++i) {
+    const uint8_t packed = read_value<uint8_t>(p + i / 2);
+    alignment.sequence[i] = BASES[(i % 2 == 0) ? (packed >> 4) : (packed & 0xF)];
+  }
+  p += (sequence_length + 1) / 2;
+
+  //Missing qualities are stored as 0xFF
+  alignment.qualities.assign(p, p + sequence_length);
+  if(sequence_length > 0 && alignment.qualities[0] == 0xFF) {
+    alignment.qualities.clear();
+  }
+  p += sequence_length;
+
+  //CIGARs with more than 65535 operations are stored in the CG tag and
+  //replaced by the placeholder kSmN (k is the length of the read)
+  if(num_operations == 2
+     && (alignment.cigar[0] & 0xF) == CIGAR_SOFT_CLIP
+     && static_cast<int32_t>(alignment.cigar[0] >> 4) == sequence_length
+     && (alignment.cigar[1] & 0xF) == CIGAR_SKIP) {
+    while(end - p >= 3) {
+      const bool is_cg = (p[0] == 'C' && p[1] == 'G');
+      const char type = p[2];
+      p += 3;
+      size_t value_size = 0;
+      if(type == 'A' || type == 'c' || type == 'C') {
+        value_size = 1;
+      } else if(type == 's' || type == 'S') {
+        value_size = 2;
+      } else if(type == 'i' || type == 'I' || type == 'f') {
+        value_size = 4;
+      } else if(type == 'Z' || type == 'H') {
+        const char *nul = static_cast<const char*>(memchr(p, '\0', end - p));
+        if(nul == NULL) {
+          parse_error("unterminated tag");
+        }
+        value_size = nul - p + 1;
+      } else if(type == 'B') {
+        if(end - p < 5) {
+          parse_error("record too short");
+        }
+        const char subtype = p[0];
+        const uint32_t count = read_value<uint32_t>(p + 1);
+        const size_t element_size = (subtype == 'c' || subtype == 'C') ? 1 :
+          ((subtype == 's' || subtype == 'S') ? 2 : 4);
+        if(static_cast<size_t>(end - p - 5) < count * element_size) {
+          parse_error("record too short");
+        }
+        if(is_cg && (subtype == 'I' || subtype == 'i')) {
+          alignment.cigar.resize(count);
+          for(uint32_t i = 0; i < count; ++i) {
+            alignment.cigar[i] = read_value<uint32_t>(p + 5 + 4 * i);
+          }
+          break;
+        }
+        value_size = 5 + count * element_size;
+      } else {
+        parse_error("unknown tag type");
+      }
+      if(static_cast<size_t>(end - p) < value_size) {
+        parse_error("record too short");
+      }
+      p += value_size;
+    }
+  }
+
+  return true;
+}
+
+
+
+//Merge the entries of the two mates of a pair (both sorted by position).
+//When both mates cover a variant, the entry with the higher quality is kept
+//if they agree on the allele, otherwise the variant is dropped.
+static
+void merge_mates(const Fragment &first, const Fragment &second, Fragment &merged)
+{
+  merged.clear();
+  Fragment::const_iterator i1 = first.begin();
+  Fragment::const_iterator i2 = second.begin();
+  while(i1 != first.end() || i2 != second.end()) {
+    if(i2 == second.end() || (i1 != first.end() && (*i1).position < (*i2).position)) {
+      merged.push_back(*i1++);
+    } else if(i1 == first.end() || (*i2).position < (*i1).position) {
+      merged.push_back(*i2++);
+    } else {
+      if((*i1).allele == (*i2).allele) {
+        merged.push_back(((*i1).phred_score >= (*i2).phred_score) ? *i1 : *i2);
+      }
+      ++i1;
+      ++i2;
+    }
+  }
+}
+
+
+
+namespace {
+
+//Fragments completed by the sweep but not yet added to the set, since a
+//fragment starting at a smaller position could still be completed.
+//They are emitted by increasing starting position (ties by completion order).
+class FragmentQueue {
+
+public:
+
+  FragmentQueue(FragmentSet &fragments, extraction_stats_t &stats)
+    : fragments(fragments), stats(stats), completed(0)
+  {}
+
+  void push(Fragment &fragment) {
+    if(fragment.empty()) {
+      return;
+    }
+    size_t slot = slots.size();
+    if(free_slots.empty()) {
+      slots.push_back(Fragment());
+    } else {
+      slot = free_slots.back();
+      free_slots.pop_back();
+    }
+    slots[slot].swap(fragment);
+    queue.push(item_t(key_t(slots[slot][0].position, completed++), slot));
+  }
+
+  //Emit the fragments starting before cutoff
+  void emit(const Pointer cutoff) {
+    while(!queue.empty() && queue.top().first.first < cutoff) {
+      emit_first();
+    }
+  }
+
+  void emit_all() {
+    while(!queue.empty()) {
+      emit_first();
+    }
+  }
+
+private:
+
+  typedef std::pair<Pointer, uint64_t> key_t;
+  typedef std::pair<key_t, size_t> item_t;
+
+  FragmentSet &fragments;
+  extraction_stats_t &stats;
+  uint64_t completed;
+  std::vector<Fragment> slots;
+  std::vector<size_t> free_slots;
+  std::priority_queue<item_t, std::vector<item_t>, std::greater<item_t> > queue;
+
+  void emit_first() {
+    const size_t slot = queue.top().second;
+    queue.pop();
+    fragments.add(slots[slot]);
+    ++stats.fragments;
+    stats.entries += slots[slot].size();
+    slots[slot].clear();
+    free_slots.push_back(slot);
+  }
+};
+
+}
+
+
+
+void extract_fragments(const std::string &alignment_filename,
+                       const std::vector<variant_t> &variants,
+                       const std::string &chromosome,
+                       const unsigned int min_base_quality,
+                       const unsigned int min_read_quality,
+                       FragmentSet &fragments, extraction_stats_t &stats)
+{
+  fragments = FragmentSet();
+  stats = extraction_stats_t();
+
+  AlignmentReader reader(alignment_filename);
+  FragmentQueue queue(fragments, stats);
+
+  //First mates waiting for the second one, by read name, and the
+  //positions of the second mates (to give up when they have been passed)
+  struct pending_t {
+    Fragment fragment;
+    Pointer mate_position;
+  };
+  std::map<std::string, pending_t> pending;
+  std::priority_queue<std::pair<Pointer, std::string>,
+                      std::vector<std::pair<Pointer, std::string> >,
+                      std::greater<std::pair<Pointer, std::string> > > pending_mates;
+  //Starting positions of the pending fragments
+  std::multiset<Pointer> pending_starts;
+
+  bool on_chromosome = false;
+  Pointer last_position = 0;
+  alignment_t alignment;
+  Fragment fragment;
+  Fragment merged;
+  while(reader.next(alignment)) {
+    ++stats.alignments;
+
+    //The alignments are sorted, hence the ones on the chromosome are consecutive
+    if(alignment.reference != chromosome) {
+      if(on_chromosome) {
+        break;
+      }
+      continue;
+    }
+    on_chromosome = true;
+    if(alignment.position < last_position) {
+      std::cerr << "ERROR: the alignments are not sorted by position: "
+                << alignment_filename << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    last_position = alignment.position;
+
+    //No mate of the pending fragments can be found from now on
+    while(!pending_mates.empty() && pending_mates.top().first < alignment.position) {
+      std::map<std::string, pending_t>::iterator ipending = pending.find(pending_mates.top().second);
+      if(ipending != pending.end() && ipending->second.mate_position == pending_mates.top().first) {
+        if(!ipending->second.fragment.empty()) {
+          pending_starts.erase(pending_starts.find(ipending->second.fragment[0].position));
+        }
+        queue.push(ipending->second.fragment);
+        pending.erase(ipending);
+      }
+      pending_mates.pop();
+    }
+
+    if((alignment.flag & FLAG_DISCARDED) != 0 || alignment.cigar.empty()) {
+      ++stats.filtered_by_flag;
+    } else if(alignment.qualities.empty()) {
+      ++stats.without_qualities;
+    } else {
+      double total_quality = 0.0;
+      for(std::vector<uint8_t>::const_iterator iquality = alignment.qualities.begin();
+          iquality != alignment.qualities.end();
+          ++iquality) {
+        total_quality += *iquality;
+      }
+
+      if(total_quality / alignment.qualities.size() < min_read_quality) {
+        ++stats.filtered_by_read_quality;
+      } else {
+        ++stats.used_alignments;
+
+        //Walk the CIGAR looking for the variants covered by aligned bases
+        fragment.clear();
+        Pointer reference_position = alignment.position;
+        size_t query_position = 0;
+        for(std::vector<uint32_t>::const_iterator ioperation = alignment.cigar.begin();
+            ioperation != alignment.cigar.end();
+            ++ioperation) {
+          const uint32_t operation = (*ioperation) & 0xF;
+          const uint32_t length = (*ioperation) >> 4;
+          if(operation == CIGAR_MATCH || operation == CIGAR_EQUAL || operation == CIGAR_DIFF) {
+            variant_t first;
+            first.position = reference_position;
+            std::vector<variant_t>::const_iterator ivariant =
+              std::lower_bound(variants.begin(), variants.end(), first, variant_before);
+            for(; ivariant != variants.end()
+                  && (*ivariant).position < reference_position + static_cast<Pointer>(length);
+                ++ivariant) {
+              const size_t query = query_position + ((*ivariant).position - reference_position);
+              if(query >= alignment.sequence.size() || query >= alignment.qualities.size()) {
+                break;
+              }
+              const char base = toupper(alignment.sequence[query]);
+              if(base != (*ivariant).ref && base != (*ivariant).alt) {
+                ++stats.other_alleles;
+              } else if(alignment.qualities[query] < min_base_quality) {
+                ++stats.filtered_by_base_quality;
+              } else {
+                fragment.push_back(EntryRead((*ivariant).position, base == (*ivariant).alt,
+                                             alignment.qualities[query]));
+              }
+            }
+            reference_position += length;
+            query_position += length;
+          } else if(operation == CIGAR_INSERTION || operation == CIGAR_SOFT_CLIP) {
+            query_position += length;
+          } else if(operation == CIGAR_DELETION || operation == CIGAR_SKIP) {
+            reference_position += length;
+          }
+        }
+
+        std::map<std::string, pending_t>::iterator ipending = pending.find(alignment.name);
+        if(ipending != pending.end()) {
+          //Second mate of a pair
+          if(!ipending->second.fragment.empty()) {
+            pending_starts.erase(pending_starts.find(ipending->second.fragment[0].position));
+          }
+          merge_mates(ipending->second.fragment, fragment, merged);
+          queue.push(merged);
+          pending.erase(ipending);
+          ++stats.merged_mates;
+        } else if((alignment.flag & FLAG_PAIRED) != 0 && (alignment.flag & FLAG_MATE_UNMAPPED) == 0
+                  && alignment.mate_reference == alignment.reference
+                  && alignment.mate_position >= alignment.position) {
+          //First mate of a pair: wait for the second one
+          pending_t &waiting = pending[alignment.name];
+          waiting.fragment.swap(fragment);
+          waiting.mate_position = alignment.mate_position;
+          pending_mates.push(std::make_pair(alignment.mate_position, alignment.name));
+          if(!waiting.fragment.empty()) {
+            pending_starts.insert(waiting.fragment[0].position);
+          }
+        } else {
+          queue.push(fragment);
+        }
+      }
+    }
+
+    //The following fragments start at or after the current alignment
+    Pointer cutoff = alignment.position;
+    if(!pending_starts.empty()) {
+      cutoff = std::min(cutoff, *pending_starts.begin());
+    }
+    queue.emit(cutoff);
+  }
+
+  for(std::map<std::string, pending_t>::iterator ipending = pending.begin();
+      ipending != pending.end();
+      ++ipending) {
+    queue.push(ipending->second.fragment);
+  }
+  queue.emit_all();
+}
@@ -0,0 +1,158 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#ifndef ALIGNMENT_READER_H
+#define ALIGNMENT_READER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdint.h>
+
+#include "basic_types.h"
+#include "mapped_file.h"
+#include "compressed_input.h"
+
+
+//Fragments kept in memory, sorted by starting position: the entries of the
+//i-th fragment are in [offsets[i], offsets[i + 1])
+struct FragmentSet {
+  std::vector<EntryRead> entries;
+  std::vector<size_t> offsets;
+
+  FragmentSet()
+    : offsets(1, 0)
+  {}
+
+  size_t size() const { return offsets.size() - 1; }
+
+  void add(const Fragment &fragment) {
+    entries.insert(entries.end(), fragment.begin(), fragment.end());
+    offsets.push_back(entries.size());
+  }
+};
+
+
+//Single nucleotide variant (1-based position)
+struct variant_t {
+  Pointer position;
+  char ref;
+  char alt;
+};
+
+//Load the SNVs of the given chromosome, sorted by position, from either a
+//VCF file (possibly gzipped) or a variant file as written by
+//utils/get.variants.py (position, reference allele and alternative allele
+//separated by tabs, for a single chromosome)
+void load_variants(const std::string &filename, const std::string &chromosome,
+                   std::vector<variant_t> &variants);
+
+
+//Alignment of a read (positions are 1-based, as in SAM files)
+struct alignment_t {
+  std::string name;
+  uint16_t flag;
+  std::string reference;
+  Pointer position;
+  uint8_t mapping_quality;
+  //Operations encoded as in BAM files: length << 4 | operation
+  std::vector<uint32_t> cigar;
+  std::string mate_reference;
+  Pointer mate_position;
+  std::string sequence;
+  //Base qualities (empty if they are not available)
+  std::vector<uint8_t> qualities;
+};
+
+
+//Sequential reader of a SAM file (plain or gzipped) or of a BAM file
+class AlignmentReader {
+
+public:
+
+  AlignmentReader(const std::string &filename);
+
+  //Read the next alignment. Return false at the end of the file.
+  bool next(alignment_t &alignment);
+
+  bool is_bam() const { return bam; }
+
+private:
+
+  std::string filename;
+  MappedFile input;
+  const char *cursor;
+  const char *limit;
+  std::unique_ptr<CompressedInput> decompressor;
+  bool bam;
+  //Names of the references of a BAM file
+  std::vector<std::string> references;
+  //Current BAM record
+  std::vector<char> record;
+
+  bool next_sam(alignment_t &alignment);
+  bool next_bam(alignment_t &alignment);
+  void read_bam_header();
+  void read_bytes(char *out, const size_t length);
+  void parse_error(const std::string &message) const;
+};
+
+
+//Statistics of the extraction of the fragments
+struct extraction_stats_t {
+  Counter alignments;
+  Counter used_alignments;
+  Counter filtered_by_flag;
+  Counter filtered_by_read_quality;
+  Counter without_qualities;
+  Counter filtered_by_base_quality;
+  Counter other_alleles;
+  Counter merged_mates;
+  Counter entries;
+  Counter fragments;
+
+  extraction_stats_t()
+    : alignments(0), used_alignments(0), filtered_by_flag(0),
+      filtered_by_read_quality(0), without_qualities(0),
+      filtered_by_base_quality(0), other_alleles(0), merged_mates(0),
+      entries(0), fragments(0)
+  {}
+};
+
+//Build the fragments of the alignments on the given chromosome at the given
+//variants with a single sweep over the (coordinate-sorted) alignments.
+//Unmapped, secondary, supplementary, duplicate and QC-failed alignments are
+//discarded, as well as the alignments whose mean base quality is less than
+//min_read_quality and the bases whose quality is less than min_base_quality.
+//The two mates of a pair form a single fragment.
+void extract_fragments(const std::string &alignment_filename,
+                       const std::vector<variant_t> &variants,
+                       const std::string &chromosome,
+                       const unsigned int min_base_quality,
+                       const unsigned int min_read_quality,
+                       FragmentSet &fragments, extraction_stats_t &stats);
+
+#endif
@@ -0,0 +1,194 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#ifndef BACKTRACE_TABLE_H
+#define BACKTRACE_TABLE_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+
+#include "basic_types.h"
+
+//The backtrace of the DP: for each column j, each distance q of a following
+//column and each combination index of the reads shared by the two columns,
+//the best jump (with the index of its combination) and whether the
+//haplotypes are swapped or a new block of heterozygous columns starts.
+//The entries are bit-packed in a single array: the jump, the index and the
+//two flags take only the bits needed by the largest values of the block.
+//A table can hold only the columns in a range [first, end).
+class BacktraceTable {
+
+public:
+
+  BacktraceTable()
+    : first(0), column_rows(1, 0), row_offsets(1, 0),
+      jump_bits(0), index_bits(0), entry_bits(2)
+  {}
+
+  //Column j has a row for each distance q < row_sizes[j].size(), of
+  //row_sizes[j][q] entries (at most max_row). The jumps are at most max_jump.
+  BacktraceTable(const std::vector<std::vector<Counter> > &row_sizes, const Counter &max_jump,
+                 const Counter &max_row, const Counter &first_column, const Counter &end_column)
+  {
+    reset(row_sizes, max_jump, max_row, first_column, end_column);
+  }
+
+  //Shape the table as a new one (as the constructor), keeping its memory
+  void reset(const std::vector<std::vector<Counter> > &row_sizes, const Counter &max_jump,
+             const Counter &max_row, const Counter &first_column, const Counter &end_column) {
+    first = first_column;
+    column_rows.assign(end_column - first_column + 1, 0);
+    for(Counter j = first; j < end_column; ++j) {
+      column_rows[j - first + 1] = column_rows[j - first] + row_sizes[j].size();
+    }
+    row_offsets.assign(column_rows.back() + 1, 0);
+    for(Counter j = first; j < end_column; ++j) {
+      const size_t rows = column_rows[j - first];
+      for(size_t q = 0; q < row_sizes[j].size(); ++q) {
+        row_offsets[rows + q + 1] = row_offsets[rows + q] + row_sizes[j][q];
+      }
+    }
+
+    //The jump is stored increased by one (0 is no jump)
+    jump_bits = bits_of(max_jump + 1);
+    index_bits = bits_of(max_row > 0 ? max_row - 1 : 0);
+    entry_bits = entry_bits_of(max_jump, max_row);
+    words.assign((row_offsets.back() * entry_bits + 63) / 64 + 1, 0);
+  }
+
+  static Counter max_row_size(const std::vector<std::vector<Counter> > &row_sizes) {
+    Counter max_row = 0;
+    for(size_t j = 0; j < row_sizes.size(); ++j) {
+      for(size_t q = 0; q < row_sizes[j].size(); ++q) {
+        max_row = std::max(max_row, row_sizes[j][q]);
+      }
+    }
+    return max_row;
+  }
+
+  //Bits of an entry of a table with jumps at most max_jump and rows of at
+  //most max_row entries
+  static unsigned int entry_bits_of(const Counter &max_jump, const Counter &max_row) {
+    return 2 + bits_of(max_jump + 1) + bits_of(max_row > 0 ? max_row - 1 : 0);
+  }
+
+  Counter first_column() const { return first; }
+  Counter end_column() const { return first + column_rows.size() - 1; }
+
+  //Copy the entries of the columns held by both tables, which must have
+  //been built from the same row sizes and maxima
+  void copy_columns(const BacktraceTable &from) {
+    const Counter begin = std::max(first_column(), from.first_column());
+    const Counter end = std::min(end_column(), from.end_column());
+    for(Counter j = begin; j < end; ++j) {
+      const size_t rows = column_rows[j - first + 1] - column_rows[j - first];
+      for(Counter q = 0; q < rows; ++q) {
+        const uint64_t size = row_offsets[column_rows[j - first] + q + 1] - row_offsets[column_rows[j - first] + q];
+        for(Counter index = 0; index < size; ++index) {
+          write(j, q, index, from.read(j, q, index));
+        }
+      }
+    }
+  }
+
+  Backtrace1 get(const Counter &j, const Counter &q, const Counter &index) const {
+    const uint64_t entry = read(j, q, index);
+    Backtrace1 back;
+    back.jump = (Pointer)((entry >> 2) & mask(jump_bits)) - 1;
+    back.index = (Counter)(entry >> (2 + jump_bits));
+    return back;
+  }
+
+  bool get_haplotypes(const Counter &j, const Counter &q, const Counter &index) const {
+    return read(j, q, index) & 1;
+  }
+
+  bool get_new_block(const Counter &j, const Counter &q, const Counter &index) const {
+    return (read(j, q, index) >> 1) & 1;
+  }
+
+  void set(const Counter &j, const Counter &q, const Counter &index,
+           const Pointer &jump, const Counter &jump_index,
+           const bool &haplotypes, const bool &new_block) {
+    write(j, q, index, (uint64_t)haplotypes | ((uint64_t)new_block << 1) |
+          ((uint64_t)(jump + 1) << 2) | ((uint64_t)jump_index << (2 + jump_bits)));
+  }
+
+  //Size in bytes of the entries
+  size_t memory() const { return words.size() * sizeof(uint64_t); }
+
+private:
+
+  //First column, first row of each column and first entry of each row
+  Counter first;
+  std::vector<size_t> column_rows;
+  std::vector<uint64_t> row_offsets;
+  std::vector<uint64_t> words;
+  unsigned int jump_bits;
+  unsigned int index_bits;
+  unsigned int entry_bits;
+
+  static unsigned int bits_of(uint64_t value) {
+    unsigned int bits = 0;
+    for(; value > 0; value >>= 1) {
+      ++bits;
+    }
+    return bits;
+  }
+
+  static uint64_t mask(const unsigned int bits) {
+    return (bits >= 64) ? ~(uint64_t)0 : (((uint64_t)1 << bits) - 1);
+  }
+
+  uint64_t position(const Counter &j, const Counter &q, const Counter &index) const {
+    return (row_offsets[column_rows[j - first] + q] + index) * entry_bits;
+  }
+
+  void write(const Counter &j, const Counter &q, const Counter &index, const uint64_t &entry) {
+    const uint64_t bit = position(j, q, index);
+    const size_t w = bit >> 6;
+    const unsigned int s = bit & 63;
+    const uint64_t m = mask(entry_bits);
+    words[w] = (words[w] & ~(m << s)) | (entry << s);
+    if(s + entry_bits > 64) {
+      words[w + 1] = (words[w + 1] & ~(m >> (64 - s))) | (entry >> (64 - s));
+    }
+  }
+
+  uint64_t read(const Counter &j, const Counter &q, const Counter &index) const {
+    const uint64_t bit = position(j, q, index);
+    const size_t w = bit >> 6;
+    const unsigned int s = bit & 63;
+    uint64_t entry = words[w] >> s;
+    if(s + entry_bits > 64) {
+      entry |= words[w + 1] << (64 - s);
+    }
+    return entry & mask(entry_bits);
+  }
+};
+
+#endif
@@ -63,10 +63,30 @@ std::ostream& operator<<(std::ostream& out, const options_t& options) {
     << "Initialized? " << (options.options_initialized?"True":"False") << SEP
     << "Input filename: '" << options.input_filename << '\'' << SEP
     << "Haplotype filename: '" << options.haplotype_filename << '\'' << SEP
+    << "Binary conversion filename: '" << options.convert_filename << '\'' << SEP
+    << "Alignment filename: '" << options.alignment_filename << '\'' << SEP
+    << "Variant filename: '" << options.variant_filename << '\'' << SEP
+    << "Chromosome: '" << options.chromosome << '\'' << SEP
+    << "Minimum base quality: " << options.min_base_quality << SEP
+    << "Minimum read quality: " << options.min_read_quality << SEP
     << "Discard weights? " << (options.unweighted?"True":"False") << SEP
     << "Mask ambiguous positions? " << (options.no_xs?"False":"True") << SEP
     << "all-heterozygous assumption?" << (options.all_heterozygous?"True":"False") << SEP
     << "read input as unique block?" << (options.unique?"True":"False") << SEP
+    << "Parse only? " << (options.parse_only?"True":"False") << SEP
+    << "Ranking benchmark? " << (options.benchmark_ranking?"True":"False") << SEP
+    << "Parsing threads: " << options.parse_threads << SEP
+    << "DP threads: " << options.dp_threads << SEP
+    << "Block threads: " << options.threads << SEP
+    << "Low-memory DP? " << (options.low_memory?"True":"False") << SEP
+    << "Region: ";
+  if(options.region) {
+    out << options.region_start << '-' << options.region_end;
+  } else {
+    out << "none";
+  }
+  out << SEP
+    << "Maximum coverage: " << options.max_coverage << SEP
     << "Error rate: " << options.error_rate << SEP
     << "Alpha: " << options.alpha;
   return out;
@@ -74,6 +94,7 @@ std::ostream& operator<<(std::ostream& out, const options_t& options) {
 
 #include <getopt.h>
 #include <sstream>
+#include <algorithm>
 
 options_t parse_arguments(int argc, char** argv) {
 
@@ -96,6 +117,31 @@ options_t parse_arguments(int argc, char** argv) {
     << "file where the computed haplotypes will" << std::endl
     << std::string(5,'\t') << "be written to" << std::endl
 
+    << "  -b [ --alignments ] arg" << std::string(2,'\t')
+    << "file containing the aligned reads (in" << std::endl
+    << std::string(5,'\t') << "SAM or BAM format), used instead of" << std::endl
+    << std::string(5,'\t') << "--input" << std::endl
+
+    << "  -V [ --variants ] arg" << std::string(3,'\t')
+    << "file containing the variants (in VCF" << std::endl
+    << std::string(5,'\t') << "format or as written by get.variants.py)" << std::endl
+
+    << "  -c [ --chromosome ] arg" << std::string(2,'\t')
+    << "chromosome of the alignments to phase" << std::endl
+
+    << "  -q [ --base-quality ] arg (="
+    << ret.min_base_quality << ")" << std::string(1,'\t')
+    << "minimum quality of the bases at the" << std::endl
+    << std::string(5,'\t') << "variants" << std::endl
+
+    << "  -Q [ --read-quality ] arg (="
+    << ret.min_read_quality << ")" << std::string(1,'\t')
+    << "minimum mean base quality of the reads" << std::endl
+
+    << "  -C [ --convert ] arg" << std::string(3,'\t')
+    << "convert the input into a binary WIF file" << std::endl
+    << std::string(5,'\t') << "(to be used as input of later runs)" << std::endl
+
     << "  -u [ --discard-weights ]" << std::string(2,'\t')
     << "discard weights" << std::endl
 
@@ -108,6 +154,45 @@ options_t parse_arguments(int argc, char** argv) {
     << "  -U [ --unique ]" << std::string(3,'\t')
     << "input as unique block" << std::endl
 
+    << "  -P [ --parse-only ]" << std::string(3,'\t')
+    << "only parse the input and report the" << std::endl
+    << std::string(5,'\t') << "parsing throughput" << std::endl
+
+    << "  -R [ --benchmark-ranking ]" << std::string(2,'\t')
+    << "only compare the table-driven ranking" << std::endl
+    << std::string(5,'\t') << "of the combinations with the" << std::endl
+    << std::string(5,'\t') << "element-by-element one" << std::endl
+
+    << "  -p [ --parse-threads ] arg (="
+    << ret.parse_threads << ")" << std::string(1,'\t')
+    << "number of threads used for parsing" << std::endl
+    << std::string(5,'\t') << "a textual input" << std::endl
+
+    << "  -D [ --dp-threads ] arg (="
+    << ret.dp_threads << ")" << std::string(2,'\t')
+    << "number of threads that evaluate the" << std::endl
+    << std::string(5,'\t') << "masks of the largest columns" << std::endl
+
+    << "  -t [ --threads ] arg (="
+    << ret.threads << ")" << std::string(2,'\t')
+    << "number of threads that solve the" << std::endl
+    << std::string(5,'\t') << "independent blocks" << std::endl
+
+    << "  -L [ --low-memory ]" << std::string(3,'\t')
+    << "keep only checkpoints of the DP and" << std::endl
+    << std::string(5,'\t') << "recompute the backtrace (slower)" << std::endl
+
+    << "  -r [ --region ] arg" << std::string(3,'\t')
+    << "only solve the blocks overlapping the" << std::endl
+    << std::string(5,'\t') << "positions start-end (using a block index" << std::endl
+    << std::string(5,'\t') << "built next to the input)" << std::endl
+
+    << "  -m [ --max-coverage ] arg (="
+    << ret.max_coverage << ")" << std::string(1,'\t')
+    << "maximum coverage of a column (reads are" << std::endl
+    << std::string(5,'\t') << "discarded to keep it, at most "
+    << MAX_COVERAGE << ")" << std::endl
+
     << "  -e [ --error-rate ] arg (="
     << ret.error_rate << ")" << std::string(1,'\t')
     << "read error rate" << std::endl
@@ -129,10 +214,24 @@ options_t parse_arguments(int argc, char** argv) {
       {"help", no_argument, 0, 'h'},
       {"input", required_argument, 0, 'i'},
       {"haplotypes", required_argument, 0, 'o'},
+      {"convert", required_argument, 0, 'C'},
+      {"alignments", required_argument, 0, 'b'},
+      {"variants", required_argument, 0, 'V'},
+      {"chromosome", required_argument, 0, 'c'},
+      {"base-quality", required_argument, 0, 'q'},
+      {"read-quality", required_argument, 0, 'Q'},
       {"discard-weights", no_argument, 0, 'u'},
       {"no-ambiguous", no_argument, 0, 'x'},
       {"all-heterozygous", no_argument, 0, 'A'},
       {"unique", no_argument, 0, 'U'},
+      {"parse-only", no_argument, 0, 'P'},
+      {"benchmark-ranking", no_argument, 0, 'R'},
+      {"parse-threads", required_argument, 0, 'p'},
+      {"dp-threads", required_argument, 0, 'D'},
+      {"threads", required_argument, 0, 't'},
+      {"low-memory", no_argument, 0, 'L'},
+      {"region", required_argument, 0, 'r'},
+      {"max-coverage", required_argument, 0, 'm'},
       {"error-rate", required_argument, 0, 'e'},
       {"alpha", required_argument, 0, 'a'},
       {0, 0, 0, 0}
@@ -140,7 +239,7 @@ options_t parse_arguments(int argc, char** argv) {
 
     // get an option
     int option_index = 0;
-    opt = getopt_long(argc, argv, "hi:o:uxAUe:a:", long_options, &option_index);
+    opt = getopt_long(argc, argv, "hi:o:C:b:V:c:q:Q:uxAUPRp:D:t:Lr:m:e:a:", long_options, &option_index);
 
     if(opt == -1) // end of options
       break;
@@ -157,6 +256,24 @@ options_t parse_arguments(int argc, char** argv) {
       case 'o' :
 	ret.haplotype_filename = optarg;
 	break;
+      case 'C' :
+	ret.convert_filename = optarg;
+	break;
+      case 'b' :
+	ret.alignment_filename = optarg;
+	break;
+      case 'V' :
+	ret.variant_filename = optarg;
+	break;
+      case 'c' :
+	ret.chromosome = optarg;
+	break;
+      case 'q' :
+	ret.min_base_quality = std::max(atoi(optarg), 0);
+	break;
+      case 'Q' :
+	ret.min_read_quality = std::max(atoi(optarg), 0);
+	break;
       case 'u' :
 	ret.unweighted = true;
 	break;
@@ -169,6 +286,39 @@ options_t parse_arguments(int argc, char** argv) {
       case 'U' :
 	ret.unique = true;
 	break;
+      case 'P' :
+	ret.parse_only = true;
+	break;
+      case 'R' :
+	ret.benchmark_ranking = true;
+	break;
+      case 'p' :
+	ret.parse_threads = std::max(atoi(optarg), 0);
+	break;
+      case 'D' :
+	ret.dp_threads = std::max(atoi(optarg), 0);
+	break;
+      case 't' :
+	ret.threads = std::max(atoi(optarg), 0);
+	break;
+      case 'L' :
+	ret.low_memory = true;
+	break;
+      case 'r' :
+	{
+	  char separator = 0;
+	  std::istringstream region(optarg);
+	  ret.region = true;
+	  if(!(region >> ret.region_start >> separator >> ret.region_end)
+	     || separator != '-' || !region.eof() || ret.region_start > ret.region_end) {
+	    sane = false;
+	    err = "region must be given as start-end, with start not greater than end";
+	  }
+	}
+	break;
+      case 'm' :
+	ret.max_coverage = std::max(atoi(optarg), 0);
+	break;
       case 'e' :
 	ret.error_rate = atof(optarg);
 	break;
@@ -182,14 +332,32 @@ options_t parse_arguments(int argc, char** argv) {
   }
 
   // sanity check on required options and ranges
-  if(ret.input_filename == "") {
+  if(ret.input_filename == "" && ret.alignment_filename == "" && !ret.benchmark_ranking) {
     sane = false;
     err = "the option '--input' is required but missing";
   }
-  if(ret.haplotype_filename == "") {
+  if(ret.input_filename != "" && ret.alignment_filename != "") {
+    sane = false;
+    err = "the options '--input' and '--alignments' cannot be used together";
+  }
+  if(ret.alignment_filename != "" && (ret.variant_filename == "" || ret.chromosome == "")) {
+    sane = false;
+    err = "the options '--variants' and '--chromosome' are required with '--alignments'";
+  }
+
+  if(ret.haplotype_filename == "" && !ret.parse_only && !ret.benchmark_ranking &&
+     ret.convert_filename == "") {
     sane = false;
     err = "the option '--haplotypes' is required but missing";
   }
+  if(ret.dp_threads < 1) {
+    sane = false;
+    err = "dp-threads must be at least 1";
+  }
+  if(ret.threads < 1) {
+    sane = false;
+    err = "threads must be at least 1";
+  }
   if((ret.error_rate < 0.0) || (ret.error_rate > 1.0)) {
     sane = false;
     err = "error-rate must be a value between 0.0 and 1.0";
@@ -198,6 +366,20 @@ options_t parse_arguments(int argc, char** argv) {
     sane = false;
     err = "alpha must be a value between 0.0 and 1.0";
   }
+  if(ret.region && ret.unique) {
+    sane = false;
+    err = "region cannot be used when the input is read as a unique block";
+  }
+  if(ret.parse_threads < 1) {
+    sane = false;
+    err = "parse-threads must be at least 1";
+  }
+  if(ret.max_coverage < 1 || ret.max_coverage > MAX_COVERAGE) {
+    sane = false;
+    std::ostringstream error;
+    error << "max-coverage must be a value between 1 and " << MAX_COVERAGE;
+    err = error.str();
+  }
 
   if(!sane) {
     std::cout << "ERROR while parsing the program options: ";
@@ -34,7 +34,9 @@
 
 #include "entry.h"
 
-#define MAX_COVERAGE 32
+//The DP represents the columns of a block as bitsets of 32, 64 or
+//MAX_COVERAGE bits, the narrowest that holds its maximum coverage
+#define MAX_COVERAGE 128
 #define MAX_CORRECTIONS 31
 
 typedef unsigned int Counter;
@@ -42,7 +44,6 @@ typedef unsigned int Counter;
 #define MAX_COUNTER std::numeric_limits<Counter>::max()
 
 typedef int Pointer;
-typedef std::bitset<MAX_COVERAGE> BitColumn;
 typedef std::vector<Entry> Column;
 typedef std::vector<Column> Block;
 
@@ -69,10 +70,26 @@ struct options_t {
   bool options_initialized;
   std::string input_filename;
   std::string haplotype_filename;
+  std::string convert_filename;
+  std::string alignment_filename;
+  std::string variant_filename;
+  std::string chromosome;
+  unsigned int min_base_quality;
+  unsigned int min_read_quality;
   bool unweighted;
   bool no_xs;
   bool all_heterozygous;
   bool unique;
+  bool parse_only;
+  bool benchmark_ranking;
+  unsigned int parse_threads;
+  unsigned int dp_threads;
+  unsigned int threads;
+  bool low_memory;
+  bool region;
+  Pointer region_start;
+  Pointer region_end;
+  Counter max_coverage;
   double error_rate;
   double alpha;
 
@@ -80,10 +97,26 @@ struct options_t {
   : options_initialized(false),
     input_filename(""),
     haplotype_filename(""),
+    convert_filename(""),
+    alignment_filename(""),
+    variant_filename(""),
+    chromosome(""),
+    min_base_quality(0),
+    min_read_quality(0),
     unweighted(false),
     no_xs(false),
     all_heterozygous(false),
     unique(false),
+    parse_only(false),
+    benchmark_ranking(false),
+    parse_threads(1),
+    dp_threads(1),
+    threads(1),
+    low_memory(false),
+    region(false),
+    region_start(0),
+    region_end(0),
+    max_coverage(30),
     error_rate(0.05),
     alpha(0.01)
   {}
@@ -93,6 +126,7 @@ struct options_t {
 std::ostream& operator<<(std::ostream& out, const options_t& options);
 
 
+template <typename BitColumn>
 struct constants_t
 {
 
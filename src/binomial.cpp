@@ -26,31 +26,77 @@
 
 #include "binomial.h"
 
-std::vector<std::vector<unsigned int> > binom_coeff::btable;
-std::vector<std::vector<unsigned int> > binom_coeff::ctable;
+#include <stdlib.h>
+#include <algorithm>
+#include <mutex>
+
+static inline unsigned int
+saturated_sum(const unsigned int a, const unsigned int b) {
+  return (a > BINOMIAL_OVERFLOW - b) ? BINOMIAL_OVERFLOW : a + b;
+}
+
+constexpr unsigned int binom_coeff::MAX_N;
+constexpr unsigned int binom_coeff::RANK_CHUNKS;
+constexpr unsigned int binom_coeff::RANK_MAX_K;
+unsigned int binom_coeff::btable[(MAX_N + 1) * (MAX_N + 1)];
+unsigned int binom_coeff::ctable[(MAX_N + 1) * (MAX_N + 1)];
+unsigned int binom_coeff::rtable[RANK_CHUNKS * (RANK_MAX_K + 1) * 256];
 
 void
 binom_coeff::initialize_binomial_coefficients(const unsigned int n,
                                               const unsigned int k) {
+  if (n > MAX_N || k > MAX_N) {
+    std::cerr << "binomial coefficients are available up to n = " << MAX_N
+              << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  // the tables are built by the first call only, hence they are never
+  // written while the threads that solve the blocks read them
+  static std::once_flag built;
+  std::call_once(built, build_tables, n, k);
+}
+
+
+
+void
+binom_coeff::build_tables(const unsigned int n, const unsigned int k) {
+  const unsigned int row = MAX_N + 1;
   // binomial coefficients
-  btable.clear();
-  btable.resize(n+1, std::vector<unsigned int>(n + 1, 0));
+  std::fill(btable, btable + row * row, 0);
   for (unsigned int i = 0; i <= n; ++i) {
     for (unsigned int j = 0; j <= i; j++) {
       if (i == 0 || j == 0 || j == i) {
-        btable[i][j] = 1;
+        btable[i * row + j] = 1;
       } else {
-        btable[i][j] = btable[i - 1][j - 1] + btable[i - 1][j];
+        btable[i * row + j] = saturated_sum(btable[(i - 1) * row + j - 1],
+                                            btable[(i - 1) * row + j]);
       }
     }
   }
   // cumulative binomial coefficients
-  ctable.clear();
-  ctable.resize(n+1, std::vector<unsigned int>(n + 1, 0));
+  std::fill(ctable, ctable + row * row, 0);
   for (unsigned int i = 0; i <= n; i++) {
     for (unsigned int j = 0; j <= k; j++) {
-      for(unsigned int x = 0; x <= j; x++) {
-        ctable[i][j] += btable[i][x];
+      ctable[i * row + j] = saturated_sum((j > 0) ? ctable[i * row + j - 1] : 0,
+                                          btable[i * row + j]);
+    }
+  }
+  // colex rank of the bytes (the sums wrap around as the ones of indexof)
+  for (unsigned int chunk = 0; chunk < RANK_CHUNKS; ++chunk) {
+    for (unsigned int preceding = 0; preceding <= RANK_MAX_K; ++preceding) {
+      for (unsigned int byte = 0; byte < 256; ++byte) {
+        unsigned int rank = 0;
+        unsigned int elements = preceding;
+        for (unsigned int i = 0; i < 8; ++i) {
+          if ((byte >> i) & 1) {
+            ++elements;
+            const unsigned int c = 8 * chunk + i;
+            if (c <= n && elements <= n) {
+              rank += btable[c * row + elements];
+            }
+          }
+        }
+        rtable[((chunk * (RANK_MAX_K + 1)) + preceding) * 256 + byte] = rank;
       }
     }
   }
@@ -27,28 +27,56 @@
 #ifndef BINOMIAL_H
 #define BINOMIAL_H
 
-#include <vector>
+#include <limits>
+
+#include "basic_types.h"
+
+#define BINOMIAL_OVERFLOW std::numeric_limits<unsigned int>::max()
 
 class binom_coeff {
 
+ public:
+  //Largest n of the tables
+  static constexpr unsigned int MAX_N = MAX_COVERAGE;
+  //The colex rank of a combination of at most RANK_MAX_K elements among the
+  //first 8 * RANK_CHUNKS ones is the sum of the ranks of its bytes
+  static constexpr unsigned int RANK_CHUNKS = 8;
+  static constexpr unsigned int RANK_MAX_K = 8;
+
  private:
-  static std::vector<std::vector<unsigned int> > btable;
-  static std::vector<std::vector<unsigned int> > ctable;
+  //Flat (n, k) tables with rows of MAX_N + 1 entries
+  static unsigned int btable[(MAX_N + 1) * (MAX_N + 1)];
+  static unsigned int ctable[(MAX_N + 1) * (MAX_N + 1)];
+  //rtable[(chunk, preceding, byte)] is the contribution to the colex rank of
+  //the elements byte of chunk (the elements 8 * chunk + i for the set bits i
+  //of byte) when preceding elements precede them
+  static unsigned int rtable[RANK_CHUNKS * (RANK_MAX_K + 1) * 256];
+
+  static void
+    build_tables(const unsigned int n, const unsigned int k);
 
  public:
   static void
     initialize_binomial_coefficients(const unsigned int n, const unsigned int k);
 
-//Note: if k > n the result is equal to 0
+//Note: if k > n the result is equal to 0. The coefficients that do not fit
+//an unsigned int are equal to BINOMIAL_OVERFLOW
   static unsigned int
     binomial_coefficient(const unsigned int n, const unsigned int k) {
-    return btable[n][k];
+    return btable[n * (MAX_N + 1) + k];
   }
 
 //Note: if k > n then k is considered equal to n
   static unsigned int
     cumulative_binomial_coefficient(const unsigned int n, const unsigned int k) {
-    return ctable[n][k];
+    return ctable[n * (MAX_N + 1) + k];
+  }
+
+//Note: chunk < RANK_CHUNKS and preceding <= RANK_MAX_K
+  static unsigned int
+    byte_rank(const unsigned int chunk, const unsigned int preceding,
+              const unsigned int byte) {
+    return rtable[((chunk * (RANK_MAX_K + 1)) + preceding) * 256 + byte];
   }
 
 };
@@ -0,0 +1,112 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#ifndef BIT_KERNELS_H
+#define BIT_KERNELS_H
+
+//Gather of the bits of a 64-bit word at the positions selected by a mask,
+//packed into the lowest bits of the result (as the pext instruction of BMI2).
+//The DP is instantiated with one of the following kernels, chosen at run time
+//by use_bmi2(), hence the binary does not require BMI2.
+
+//Portable kernel. Gathering bit by bit is slower than updating the
+//projections read by read (see MaskProjection), hence the DP does not gather
+//with it.
+struct PortableBits {
+  static const bool gathers = false;
+
+  static unsigned long long gather(unsigned long long value, unsigned long long selector) {
+    unsigned long long result = 0;
+    for(unsigned long long bit = 1; selector != 0; bit <<= 1) {
+      if(value & selector & -selector) {
+        result |= bit;
+      }
+      selector &= selector - 1;
+    }
+    return result;
+  }
+};
+
+#if defined(__x86_64__) && defined(__GNUC__)
+
+#include <cpuid.h>
+
+//BMI2 kernel, written in assembly so that it is built whatever the target of
+//the compiler (it must be used only if use_bmi2())
+struct Bmi2Bits {
+  static const bool gathers = true;
+
+  static unsigned long long gather(unsigned long long value, unsigned long long selector) {
+    unsigned long long result;
+    __asm__("pextq %2, %1, %0" : "=r"(result) : "r"(value), "rm"(selector));
+    return result;
+  }
+};
+
+inline bool has_bmi2() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("bmi2");
+}
+
+//The pext of the AMD CPUs before Zen 3 (family 0x19) is microcoded and its
+//latency grows with the bits of the selector: gathering with it is slower
+//than the portable kernel
+inline bool has_slow_pext() {
+  __builtin_cpu_init();
+  if(!__builtin_cpu_is("amd")) {
+    return false;
+  }
+  unsigned int eax, ebx, ecx, edx;
+  if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    return true;
+  }
+  unsigned int family = (eax >> 8) & 0xf;
+  if(family == 0xf) {
+    family += (eax >> 20) & 0xff;
+  }
+  return family < 0x19;
+}
+
+#else
+
+typedef PortableBits Bmi2Bits;
+
+inline bool has_bmi2() {
+  return false;
+}
+
+inline bool has_slow_pext() {
+  return false;
+}
+
+#endif
+
+//Return true if the DP gathers the projections with the BMI2 kernel
+inline bool use_bmi2() {
+  return has_bmi2() && !has_slow_pext();
+}
+
+#endif
@@ -0,0 +1,188 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#include "block_index.h"
+#include "blockreader.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#define BLOCK_INDEX_HEADER "#HapCol block index"
+#define BLOCK_INDEX_VERSION 2
+
+
+//Size and modification time (in nanoseconds) of a file, used to detect
+//stale sidecars
+static
+bool file_signature(const std::string &filename, uint64_t &size, int64_t &mtime)
+{
+  struct stat info;
+  if(stat(filename.c_str(), &info) != 0) {
+    return false;
+  }
+  size = info.st_size;
+  mtime = (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+  return true;
+}
+
+
+
+std::string BlockIndex::filename(const std::string &input_filename)
+{
+  return input_filename + ".hbi";
+}
+
+
+
+void BlockIndex::build(const std::string &input_filename, const unsigned int parse_threads)
+{
+  blocks.clear();
+
+  //The blocks are the same whatever the coverage threshold and the weights
+  BlockReader reader(input_filename, MAX_COUNTER, false, false, parse_threads);
+  while(reader.has_next()) {
+    const std::vector<Pointer> &positions = reader.get_block_positions();
+    if(positions.empty()) {
+      continue;
+    }
+
+    entry_t entry;
+    entry.offset = reader.get_block_offset();
+    entry.first_position = positions.front();
+    entry.last_position = positions.back();
+    entry.num_reads = reader.get_fragment_offsets().size() - 1;
+    blocks.push_back(entry);
+  }
+}
+
+
+
+bool BlockIndex::read(const std::string &input_filename)
+{
+  blocks.clear();
+
+  uint64_t size = 0;
+  int64_t mtime = 0;
+  if(!file_signature(input_filename, size, mtime)) {
+    return false;
+  }
+
+  std::ifstream ifs(filename(input_filename).c_str(), std::ios::in);
+  if(!ifs.is_open()) {
+    return false;
+  }
+
+  std::string line;
+  getline(ifs, line);
+  if(line.compare(0, sizeof(BLOCK_INDEX_HEADER) - 1, BLOCK_INDEX_HEADER) != 0) {
+    return false;
+  }
+  std::istringstream header(line.substr(sizeof(BLOCK_INDEX_HEADER) - 1));
+  int version = 0;
+  uint64_t indexed_size = 0;
+  int64_t indexed_mtime = 0;
+  uint64_t num_blocks = 0;
+  if(!(header >> version >> indexed_size >> indexed_mtime >> num_blocks)
+     || version != BLOCK_INDEX_VERSION || indexed_size != size || indexed_mtime != mtime) {
+    return false;
+  }
+
+  //A truncated sidecar has fewer blocks than its header
+  entry_t entry;
+  while(ifs >> entry.offset >> entry.first_position >> entry.last_position >> entry.num_reads) {
+    blocks.push_back(entry);
+  }
+  if(!ifs.eof() || blocks.size() != num_blocks) {
+    blocks.clear();
+    return false;
+  }
+
+  return true;
+}
+
+
+
+bool BlockIndex::write(const std::string &input_filename) const
+{
+  uint64_t size = 0;
+  int64_t mtime = 0;
+  if(!file_signature(input_filename, size, mtime)) {
+    return false;
+  }
+
+  //The sidecar is written to a temporary file and then renamed, hence a
+  //crashed or concurrent run never reads it partially written
+  std::ostringstream temp_filename;
+  temp_filename << filename(input_filename) << ".tmp." << getpid();
+  std::ofstream ofs(temp_filename.str().c_str(), std::ios::out);
+  if(!ofs.is_open()) {
+    return false;
+  }
+
+  ofs << BLOCK_INDEX_HEADER << '\t' << BLOCK_INDEX_VERSION << '\t'
+      << size << '\t' << mtime << '\t' << blocks.size() << '\n';
+  for(std::vector<entry_t>::const_iterator iblock = blocks.begin();
+      iblock != blocks.end();
+      ++iblock) {
+    ofs << (*iblock).offset << '\t' << (*iblock).first_position << '\t'
+        << (*iblock).last_position << '\t' << (*iblock).num_reads << '\n';
+  }
+  ofs.close();
+
+  if(ofs.fail() || rename(temp_filename.str().c_str(), filename(input_filename).c_str()) != 0) {
+    remove(temp_filename.str().c_str());
+    return false;
+  }
+  return true;
+}
+
+
+
+//The blocks are sorted by position and their ranges do not overlap (a block
+//ends when the next fragment starts after all the positions of the block)
+void BlockIndex::overlapping(const Pointer start, const Pointer end,
+                             size_t &first, size_t &last) const
+{
+  size_t low = 0;
+  size_t high = blocks.size();
+  while(low < high) {
+    const size_t middle = low + (high - low) / 2;
+    if(blocks[middle].last_position < start) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  first = low;
+  last = first;
+  while(last < blocks.size() && blocks[last].first_position <= end) {
+    ++last;
+  }
+}
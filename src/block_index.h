@@ -0,0 +1,80 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#ifndef BLOCK_INDEX_H
+#define BLOCK_INDEX_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "basic_types.h"
+
+
+//Index of the independent blocks of a (textual or binary) WIF file, stored
+//in a sidecar file next to it (see filename). For each block, it records the
+//offset given by BlockReader::get_block_offset, the range of its positions
+//and the number of its reads.
+//
+//The sidecar is a textual file: a header line with the format version, the
+//size and the modification time (in nanoseconds) of the indexed file and the
+//number of blocks, then a line for each block with its offset, first
+//position, last position and number of reads. It is replaced atomically.
+class BlockIndex {
+
+public:
+
+  struct entry_t {
+    uint64_t offset;
+    Pointer first_position;
+    Pointer last_position;
+    uint64_t num_reads;
+  };
+
+  //Name of the sidecar of the given WIF file
+  static std::string filename(const std::string &input_filename);
+
+  //Build the index by reading all the blocks of the input
+  void build(const std::string &input_filename, const unsigned int parse_threads);
+
+  //Read the sidecar of the input. Return false if it does not exist, it is
+  //not well formatted or it does not match the current input file.
+  bool read(const std::string &input_filename);
+  //Write the sidecar of the input. Return false on errors.
+  bool write(const std::string &input_filename) const;
+
+  //Set [first, last) to the blocks with some position in [start, end]
+  void overlapping(const Pointer start, const Pointer end,
+                   size_t &first, size_t &last) const;
+
+  const std::vector<entry_t>& get_blocks() const { return blocks; }
+
+private:
+
+  std::vector<entry_t> blocks;
+};
+
+#endif
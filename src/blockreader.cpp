@@ -28,35 +28,48 @@
 
 
 
+
 bool BlockReader::has_next_nounique() 
 {
   if(end) {
     return false;
+  } else if(binary) {
+    //An empty input gives an empty block (as for the textual input)
+    block_offset = next_binary_block;
+    if(wifb.num_blocks() == 0) {
+      clear_fragments();
+    } else {
+      load_binary_blocks(next_binary_block, next_binary_block + 1);
+      ++next_binary_block;
+    }
+    select_block_fragments();
+    already_got = false;
+    end = (next_binary_block >= wifb.num_blocks());
+
+    return true;
   } else {
-    fragment_block.clear();
-    read_positions.clear();
-    max_position = -1;
+    clear_fragments();
     if(!last_fragment.empty()) {
+      block_offset = last_fragment_offset;
       add_positions(last_fragment);
-      fragment_block.push_back(last_fragment);
+      add_fragment(last_fragment);
     }
     Fragment read;
-    string line;
 
     bool end_block = false;
     while (!end_block) {
-      if(!input.eof()) {
-        getline(input, line, '\n');
-        if(!line.empty()) {
-          string_to_fragment(line, read);
-          if(read[0].position <= max_position || max_position == -1) {
-            add_positions(read);
-            fragment_block.push_back(read);
-          } else {
-            end_block = true;
-            already_got = false;
-            last_fragment = read;
+      if(next_fragment(read)) {
+        if(read[0].position <= max_position || max_position == -1) {
+          if(max_position == -1) {
+            block_offset = fragment_offset;
           }
+          add_positions(read);
+          add_fragment(read);
+        } else {
+          end_block = true;
+          already_got = false;
+          last_fragment = read;
+          last_fragment_offset = fragment_offset;
         }
       } else {
         end_block = true;
@@ -64,6 +77,8 @@ bool BlockReader::has_next_nounique()
         end = true;
       }
     }
+    sort_positions();
+    select_block_fragments();
 
     return true;
   }
@@ -76,35 +91,313 @@ bool BlockReader::has_next_unique()
   if(end) {
     return false;
   } else {
-    fragment_block.clear();
-    read_positions.clear();
-    max_position = -1;
+    //The columns are computed on demand by next_column
+    clear_fragments();
+    select_input_fragments();
+    restart_columns();
 
-    Fragment read;
-    string line;
+    already_got = false;
+    end = true;
 
-    while (!input.eof()) {
-      getline(input, line, '\n');
-      if(!line.empty()) {
-        string_to_fragment(line, read);        
-        add_positions(read);
-        fragment_block.push_back(read);
+    return true;
+  }
+}
+
+
+
+void BlockReader::seek_block(const uint64_t offset)
+{
+  if(binary) {
+    next_binary_block = offset;
+    end = (offset >= wifb.num_blocks());
+  } else {
+    restart_parsing(offset);
+    last_fragment.clear();
+    end = false;
+  }
+  already_got = false;
+}
+
+
+
+void BlockReader::restart_columns()
+{
+  restart_parsing(0);
+  next_binary_fragment = 0;
+
+  active_fragments.clear();
+  has_pending_fragment = false;
+  pending_offset = 0;
+  next_read_id = 0;
+  last_column_position = -1;
+}
+
+
+
+//Same columns built by extract_block on the whole input, where the read id
+//of each fragment is its index in the input
+bool BlockReader::next_column(Column &column)
+{
+  column.clear();
+
+  if(!has_pending_fragment) {
+    has_pending_fragment = read_pending_fragment();
+  }
+
+  //The position of the column is the smallest position not yet considered
+  bool found = false;
+  Pointer position = 0;
+  for(vector<ActiveFragment>::const_iterator ifragment = active_fragments.begin();
+      ifragment != active_fragments.end();
+      ++ifragment) {
+    const Pointer next_position = (*ifragment).entries[(*ifragment).next].position;
+    if(!found || next_position < position) {
+      position = next_position;
+      found = true;
+    }
+  }
+  if(has_pending_fragment && (!found || pending_fragment[0].position < position)) {
+    position = pending_fragment[0].position;
+    found = true;
+  }
+
+  if(!found) {
+    return false;
+  }
+
+  if(position <= last_column_position) {
+    cerr << "ERROR: the fragments of the input wif are not sorted by starting position" << endl;
+    exit(EXIT_FAILURE);
+  }
+  last_column_position = position;
+
+  //The fragments starting at the current position become active. The
+  //discarded ones still give their positions, but no entries.
+  while(has_pending_fragment && pending_fragment[0].position == position) {
+    if(next_read_id > MAX_READID) {
+      cerr << "ERROR: too many reads in the input (at most " << (MAX_READID + 1)
+           << " when read as a unique block)" << endl;
+      exit(EXIT_FAILURE);
+    }
+    active_fragments.push_back(ActiveFragment());
+    active_fragments.back().read_id = next_read_id;
+    active_fragments.back().selected = selected_fragments.empty() || selected_fragments[next_read_id];
+    ++next_read_id;
+    active_fragments.back().entries.swap(pending_fragment);
+    active_fragments.back().next = 0;
+    has_pending_fragment = read_pending_fragment();
+  }
+
+  size_t still_active = 0;
+  for(size_t i = 0; i < active_fragments.size(); ++i) {
+    ActiveFragment &fragment = active_fragments[i];
+    const EntryRead &entry = fragment.entries[fragment.next];
+    if(!fragment.selected) {
+      if(entry.position == position) {
+        ++fragment.next;
+      }
+    } else if(entry.position == position) {
+      column.push_back(Entry(fragment.read_id,
+                             (entry.allele) ? Entry::MINOR_ALLELE : Entry::MAJOR_ALLELE,
+                             entry.phred_score));
+      ++fragment.next;
+    } else {
+      if(unweighted) {
+        cerr << "ERROR: HapCol cannot manage gaps in the unweighted version" << endl;
+        exit(EXIT_FAILURE);
+      } else {
+        column.push_back(Entry(fragment.read_id,
+                               Entry::BLANK,
+                               0));
       }
     }
 
-    already_got = false;
-    end = true;
+    //Fragments are dropped as soon as their last position has been passed
+    if(fragment.next < fragment.entries.size()) {
+      if(still_active != i) {
+        active_fragments[still_active].read_id = fragment.read_id;
+        active_fragments[still_active].selected = fragment.selected;
+        active_fragments[still_active].entries.swap(fragment.entries);
+        active_fragments[still_active].next = fragment.next;
+      }
+      ++still_active;
+    }
+  }
+  active_fragments.resize(still_active);
 
-    return true;
+  return true;
+}
+
+
+
+//Read the next fragment of the sweep, keeping the offset from which it can
+//be read again (the end of the input if there are no more fragments)
+bool BlockReader::read_pending_fragment()
+{
+  const bool read = read_fragment(pending_fragment);
+  if(binary) {
+    pending_offset = (read) ? next_binary_fragment - 1 : wifb.num_fragments();
+  } else if(fragment_set != NULL) {
+    pending_offset = (read) ? fragment_offset : fragment_set->size();
+  } else {
+    pending_offset = (read) ? fragment_offset : input.size();
+  }
+  return read;
+}
+
+
+
+void BlockReader::save_sweep(sweep_state_t &state) const
+{
+  state.active_fragments = active_fragments;
+  state.has_pending_fragment = has_pending_fragment;
+  state.pending_offset = pending_offset;
+  state.next_read_id = next_read_id;
+  state.last_column_position = last_column_position;
+}
+
+
+
+void BlockReader::restore_sweep(const sweep_state_t &state)
+{
+  if(!is_sweep_restorable()) {
+    cerr << "ERROR: the sweep of a compressed input cannot be restored" << endl;
+    exit(EXIT_FAILURE);
+  }
+  active_fragments = state.active_fragments;
+  next_read_id = state.next_read_id;
+  last_column_position = state.last_column_position;
+
+  if(binary) {
+    next_binary_fragment = state.pending_offset;
+  } else {
+    restart_parsing(state.pending_offset);
+  }
+  has_pending_fragment = state.has_pending_fragment && read_pending_fragment();
+}
+
+
+
+//Copy the fragments of the binary blocks in [first_block, end_block) as the
+//current block. The positions are already sorted in the binary file and the
+//ones of consecutive blocks do not overlap.
+void BlockReader::load_binary_blocks(const uint64_t first_block, const uint64_t end_block)
+{
+  clear_fragments();
+
+  const uint64_t first_fragment = wifb.block_fragments[first_block];
+  const uint64_t end_fragment = wifb.block_fragments[end_block];
+  const uint64_t first_entry = wifb.fragment_offsets[first_fragment];
+  const uint64_t end_entry = wifb.fragment_offsets[end_fragment];
+
+  fragment_offsets.resize(end_fragment - first_fragment + 1);
+  for(uint64_t f = first_fragment; f <= end_fragment; ++f) {
+    fragment_offsets[f - first_fragment] = wifb.fragment_offsets[f] - first_entry;
+  }
+
+  fragment_entries.reserve(end_entry - first_entry);
+  for(uint64_t e = first_entry; e < end_entry; ++e) {
+    fragment_entries.push_back(EntryRead(wifb.positions[e], wifb.allele(e),
+                                         (unweighted) ? 1 : wifb.phred_scores[e]));
+  }
+
+  block_positions.assign(wifb.block_positions + wifb.block_position_offsets[first_block],
+                         wifb.block_positions + wifb.block_position_offsets[end_block]);
+}
+
+
+
+void BlockReader::clear_fragments()
+{
+  fragment_entries.clear();
+  fragment_offsets.assign(1, 0);
+  block_positions.clear();
+  read_positions.clear();
+  max_position = -1;
+}
+
+
+
+void BlockReader::add_fragment(const Fragment &read)
+{
+  fragment_entries.insert(fragment_entries.end(), read.begin(), read.end());
+  fragment_offsets.push_back(fragment_entries.size());
+}
+
+
+
+void BlockReader::sort_positions()
+{
+  block_positions.assign(read_positions.begin(), read_positions.end());
+  std::sort(block_positions.begin(), block_positions.end());
+}
+
+
+
+void BlockReader::select_block_fragments()
+{
+  selected_fragments.clear();
+  if(threshold_cov == MAX_COUNTER) {
+    return;
   }
+
+  vector<fragment_summary_t> summaries;
+  summaries.reserve(fragment_offsets.size() - 1);
+  for(size_t i = 0; i + 1 < fragment_offsets.size(); ++i) {
+    summaries.push_back(fragment_summary_t(fragment_entries.begin() + fragment_offsets[i],
+                                           fragment_entries.begin() + fragment_offsets[i + 1]));
+  }
+  discarded_fragments += select_fragments(summaries, block_positions, threshold_cov,
+                                          selected_fragments);
+}
+
+
+
+//In unique mode the selection is done once, by a first sweep that keeps
+//only the summaries and the positions of the fragments
+void BlockReader::select_input_fragments()
+{
+  selected_fragments.clear();
+  if(threshold_cov == MAX_COUNTER) {
+    return;
+  }
+
+  restart_columns();
+  vector<fragment_summary_t> summaries;
+  vector<Pointer> positions;
+  Fragment read;
+  while(read_fragment(read)) {
+    summaries.push_back(fragment_summary_t(read.begin(), read.end()));
+    for(Fragment::const_iterator ientry = read.begin(); ientry != read.end(); ++ientry) {
+      positions.push_back((*ientry).position);
+    }
+  }
+  std::sort(positions.begin(), positions.end());
+  positions.erase(std::unique(positions.begin(), positions.end()), positions.end());
+
+  discarded_fragments += select_fragments(summaries, positions, threshold_cov,
+                                          selected_fragments);
 }
 
 
 
 
-Block BlockReader::get_block() {
+shared_ptr<const Block> BlockReader::get_block() {
   if(!already_got) {
-    extract_block();
+    if(!block || block.use_count() > 1) {
+      block.reset(new Block());
+    }
+    if(unique) {
+      //Materialize the whole sweep
+      block->clear();
+      restart_columns();
+      Column column;
+      while(next_column(column)) {
+        block->push_back(column);
+      }
+    } else {
+      extract_block();
+    }
     already_got = true;
   }
 
@@ -115,6 +408,144 @@ Block BlockReader::get_block() {
 
 
 
+bool BlockReader::next_fragment(Fragment &read)
+{
+  if(parser) {
+    return parser->next_fragment(read, fragment_offset);
+  }
+
+  if(fragment_set != NULL) {
+    if(next_set_fragment >= fragment_set->size()) {
+      return false;
+    }
+    read.assign(fragment_set->entries.begin() + fragment_set->offsets[next_set_fragment],
+                fragment_set->entries.begin() + fragment_set->offsets[next_set_fragment + 1]);
+    if(unweighted) {
+      for(Fragment::iterator ientry = read.begin(); ientry != read.end(); ++ientry) {
+        (*ientry).phred_score = 1;
+      }
+    }
+    fragment_offset = next_set_fragment++;
+    return true;
+  }
+
+  const char *line_end = NULL;
+  const char *line = (decompressor)
+    ? decompressor->next_line(line_end)
+    : next_wif_line(cursor, limit, line_end);
+  if(line == NULL) {
+    return false;
+  }
+  //Lines of a compressed input have no offset in the mapped file
+  fragment_offset = (decompressor) ? 0 : line - input.data();
+  parse_fragment(line, line_end, read);
+  return true;
+}
+
+
+
+//Read the next fragment of the input (either textual or binary)
+bool BlockReader::read_fragment(Fragment &read)
+{
+  if(!binary) {
+    return next_fragment(read);
+  }
+
+  if(next_binary_fragment >= wifb.num_fragments()) {
+    return false;
+  }
+
+  read.clear();
+  for(uint64_t e = wifb.fragment_offsets[next_binary_fragment];
+      e < wifb.fragment_offsets[next_binary_fragment + 1];
+      ++e) {
+    read.push_back(EntryRead(wifb.positions[e], wifb.allele(e),
+                             (unweighted) ? 1 : wifb.phred_scores[e]));
+  }
+  ++next_binary_fragment;
+  return true;
+}
+
+
+
+void BlockReader::parse_fragment(const char *begin, const char *end, Fragment &read)
+{
+  const char *error = parse_wif_line(begin, end, unweighted, read);
+  if(error != NULL) {
+    cerr << error << endl;
+    exit(EXIT_FAILURE);
+  }
+}
+
+
+
+void BlockReader::restart_parsing(const size_t start)
+{
+  if(fragment_set != NULL) {
+    next_set_fragment = start;
+    return;
+  }
+
+  cursor = input.data() + start;
+  if(compressed) {
+    //The previous decompressor is stopped before starting from the beginning
+    decompressor.reset();
+    decompressor.reset(new CompressedInput(input.data(), input.size()));
+  } else if(!binary && parse_threads > 1) {
+    //The workers of the previous parser are stopped before starting the new ones
+    parser.reset();
+    parser.reset(new ChunkedWifParser(input.data(), input.size(), start, parse_threads, unweighted));
+  }
+}
+
+
+
+Counter BlockReader::parse_all(const bool &legacy, Counter &num_entries)
+{
+  Counter num_fragments = 0;
+  num_entries = 0;
+  Fragment read;
+
+  if(binary) {
+    //Nothing to be parsed: just load all the fragments
+    load_binary_blocks(0, wifb.num_blocks());
+    num_fragments = fragment_offsets.size() - 1;
+    num_entries = fragment_entries.size();
+  } else if(legacy) {
+    ifstream legacy_input(filename.c_str(), ios::in);
+    if(!legacy_input.is_open()) {
+      cerr << "ERROR: failing opening the input file: " << filename << endl;
+      exit(EXIT_FAILURE);
+    }
+
+    string line;
+    while(!legacy_input.eof()) {
+      getline(legacy_input, line, '\n');
+      if(!line.empty()) {
+        string_to_fragment(line, read);
+        ++num_fragments;
+        num_entries += read.size();
+      }
+    }
+  } else {
+    restart_parsing(0);
+    while(next_fragment(read)) {
+      ++num_fragments;
+      num_entries += read.size();
+    }
+  }
+
+  //Nothing is left to be read
+  parser.reset();
+  decompressor.reset();
+  cursor = limit;
+  end = true;
+
+  return num_fragments;
+}
+
+
+
 void BlockReader::string_to_fragment(const string &line, Fragment &read) 
 {
   read.clear();
@@ -189,49 +620,54 @@ void BlockReader::add_positions(const Fragment &read)
 //Assumption: the fragments of the input wif are sorted by starting position
 void BlockReader::extract_block()
 {
-  fragment_pointers.clear();
+  const size_t num_fragments = fragment_offsets.size() - 1;
   unsigned int starting_fragment = 0;
-  Counter current_cov = 0;
-  block.clear();
+  Block &columns = *block;
+  columns.clear();
+  columns.reserve(block_positions.size());
+
+  //The read id of an entry is the index of its fragment in the block
+  if(num_fragments > static_cast<size_t>(MAX_READID) + 1) {
+    cerr << "ERROR: too many reads in a block (at most " << (MAX_READID + 1) << ")" << endl;
+    exit(EXIT_FAILURE);
+  }
 
-  vector<int> vread_positions(read_positions.begin(), read_positions.end());
-  std::sort(vread_positions.begin(), vread_positions.end());
+  //Index of the next entry of each fragment to be placed in a column
+  fragment_pointers.assign(fragment_offsets.begin(), fragment_offsets.end() - 1);
 
-  for(vector<Fragment>::const_iterator ifblock = fragment_block.begin();
-      ifblock != fragment_block.end();
-      ++ifblock) {
-    fragment_pointers.push_back((*ifblock).begin());
-  }
-  
-  for(vector<int>::const_iterator current_position = vread_positions.begin();
-      current_position != vread_positions.end();
+  for(vector<Pointer>::const_iterator current_position = block_positions.begin();
+      current_position != block_positions.end();
       ++current_position) {
-    block.push_back(Column());
-        
-    current_cov = 0;
+    columns.push_back(Column());
+
     for(unsigned int iread = starting_fragment;
-        iread < fragment_pointers.size() && ( (fragment_pointers[iread] != fragment_block[iread].begin()) || 
-                                              ((*fragment_pointers[iread]).position == *current_position) );
+        iread < num_fragments && ( (fragment_pointers[iread] != fragment_offsets[iread]) ||
+                                   (fragment_entries[fragment_pointers[iread]].position == *current_position) );
         ++iread) {
             
 
-      if(fragment_pointers[iread] != fragment_block[iread].end()) {
-        if(++current_cov > threshold_cov) {
-          cerr << "ERROR: coverage threshold excedeed:  "<< current_cov << endl;
-          exit(EXIT_FAILURE);
+      if(fragment_pointers[iread] != fragment_offsets[iread + 1]) {
+        const EntryRead &entry = fragment_entries[fragment_pointers[iread]];
+
+        //The discarded fragments are only moved along their positions
+        if(!selected_fragments.empty() && !selected_fragments[iread]) {
+          if(entry.position == *current_position) {
+            ++fragment_pointers[iread];
+          }
+          continue;
         }
-        
-        if((*fragment_pointers[iread]).position == *current_position) {
-          block.back().push_back(Entry(iread,
-                                       ((*fragment_pointers[iread]).allele) ? Entry::MINOR_ALLELE : Entry::MAJOR_ALLELE,
-                                       (*fragment_pointers[iread]).phred_score));
+
+        if(entry.position == *current_position) {
+          columns.back().push_back(Entry(iread,
+                                       (entry.allele) ? Entry::MINOR_ALLELE : Entry::MAJOR_ALLELE,
+                                       entry.phred_score));
           ++fragment_pointers[iread];
         } else {
           if(unweighted) {
             cerr << "ERROR: HapCol cannot manage gaps in the unweighted version" << endl;
             exit(EXIT_FAILURE);
           } else {
-            block.back().push_back(Entry(iread,
+            columns.back().push_back(Entry(iread,
                                          Entry::BLANK,
                                          0));
           }
@@ -240,13 +676,9 @@ void BlockReader::extract_block()
       }
     }
 
-    while(fragment_pointers[starting_fragment] == fragment_block[starting_fragment].end()) {
+    while(starting_fragment < num_fragments &&
+          fragment_pointers[starting_fragment] == fragment_offsets[starting_fragment + 1]) {
       ++starting_fragment;
     }
   }
 }
-
-
-
-
-
@@ -34,9 +34,16 @@
 #include <algorithm>
 #include <sstream>
 #include <ios>
+#include <memory>
 
 #include "basic_types.h"
 #include "entry.h"
+#include "mapped_file.h"
+#include "wifb.h"
+#include "wif_parser.h"
+#include "compressed_input.h"
+#include "alignment_reader.h"
+#include "read_selection.h"
 
 using namespace std;
 
@@ -46,27 +53,71 @@ class BlockReader {
 
 public:
 
-  BlockReader(const string &f, const Counter &m, const bool &u, const bool &que) {
+  //The columns of a block are spanned by at most m fragments: if there are
+  //more, some of them are discarded (see select_fragments). If m is
+  //MAX_COUNTER, all the fragments are kept.
+  //If t is greater than 1, a textual input is parsed by t threads
+  BlockReader(const string &f, const Counter &m, const bool &u, const bool &que,
+              const unsigned int &t) {
     filename = f;
     threshold_cov = m;
     unweighted = u;
     unique = que;
+    parse_threads = t;
+    fragment_set = NULL;
 
-    try {
-      input.open(filename, ios::in);
-    } catch(exception & e) { 
-      cerr << "ERROR: failing opening the input file: " << filename << "\": " << e.what() << endl;
+    if(!input.open(filename)) {
+      cerr << "ERROR: failing opening the input file: " << filename << endl;
       exit(EXIT_FAILURE);
     }
+    cursor = input.data();
+    limit = input.data() + input.size();
 
-    if(!input.is_open()) {
-      cerr << "ERROR: failing opening the input file: " << filename << endl;
-      exit(EXIT_FAILURE);
+    compressed = CompressedInput::has_magic(input.data(), input.size());
+    binary = !compressed && WifbFile::has_magic(input.data(), input.size());
+    if(binary) {
+      string error;
+      if(!wifb.attach(input.data(), input.size(), error)) {
+        cerr << "ERROR: binary wif input file not well formatted: " << error << endl;
+        exit(EXIT_FAILURE);
+      }
+      next_binary_block = 0;
     }
+    next_binary_fragment = 0;
+    restart_parsing(0);
+    has_pending_fragment = false;
+    block_offset = 0;
+    next_read_id = 0;
+    discarded_fragments = 0;
+
+    already_got = false;
+    end = false;
+  }
+
+  //Read the fragments of a set already in memory (e.g., the ones extracted
+  //from an alignment file), which must outlive the reader
+  BlockReader(const FragmentSet &fragments, const Counter &m, const bool &u, const bool &que) {
+    threshold_cov = m;
+    unweighted = u;
+    unique = que;
+    parse_threads = 1;
+    fragment_set = &fragments;
+
+    cursor = NULL;
+    limit = NULL;
+    compressed = false;
+    binary = false;
+    next_binary_fragment = 0;
+    restart_parsing(0);
+    has_pending_fragment = false;
+    block_offset = 0;
+    next_read_id = 0;
+    discarded_fragments = 0;
 
     already_got = false;
     end = false;
   }
+
   ~BlockReader() { }
 
   bool has_next() {
@@ -77,7 +128,76 @@ public:
     }
   }
 
-  Block get_block();
+  //The block found by the last has_next. It is never modified afterwards,
+  //hence it can be shared by several readers (the next block is built in a
+  //new storage if the previous one is still in use).
+  shared_ptr<const Block> get_block();
+
+  //Offset of the block found by the last has_next (not in unique mode):
+  //the byte offset of its first fragment for a textual input, the index of
+  //the block for a binary input, the index of its first fragment for a set
+  //of fragments (not available for a compressed input)
+  uint64_t get_block_offset() const { return block_offset; }
+  //Make the next has_next start from the block at the given offset, as
+  //returned by get_block_offset (not in unique mode)
+  void seek_block(const uint64_t offset);
+
+  //In unique mode the input is not kept in memory: the columns of the
+  //unique block are produced one at a time by a sweep over the input that
+  //keeps only the fragments covering the current column.
+  bool is_streaming() const { return unique; }
+  //Start (again) the sweep from the first column
+  void restart_columns();
+  //Compute the next column of the sweep. Return false if there are no more columns.
+  bool next_column(Column &column);
+
+  //Fragment covering the current column of the sweep
+  struct ActiveFragment {
+    readid_t read_id;
+    bool selected;
+    Fragment entries;
+    size_t next;
+  };
+  //State of the sweep after a column, from which it can be started again
+  struct sweep_state_t {
+    vector<ActiveFragment> active_fragments;
+    bool has_pending_fragment;
+    uint64_t pending_offset;
+    readid_t next_read_id;
+    Pointer last_column_position;
+  };
+  //Return true if the sweep can be started again from a saved state (the
+  //input is not compressed)
+  bool is_sweep_restorable() const { return !compressed; }
+  void save_sweep(sweep_state_t &state) const;
+  void restore_sweep(const sweep_state_t &state);
+
+  //Parse the whole input without building blocks (used for benchmarking the
+  //tokenizer). If legacy is true, the old getline/stringstream path is used.
+  //Return the number of fragments and set num_entries to the number of entries.
+  Counter parse_all(const bool &legacy, Counter &num_entries);
+
+  size_t input_size() const { return input.size(); }
+
+  bool is_binary() const { return binary; }
+
+  //Return true if the input is a gzip (or BGZF) compressed WIF file
+  bool is_compressed() const { return compressed; }
+
+  //Return true if the blocks can be stored in a block index (the input is a
+  //file that is not compressed)
+  bool is_indexable() const { return !compressed && fragment_set == NULL; }
+
+  //Fragments of the block found by the last has_next: the entries of the
+  //i-th fragment are in [fragment_offsets[i], fragment_offsets[i + 1])
+  const vector<EntryRead>& get_fragment_entries() const { return fragment_entries; }
+  const vector<size_t>& get_fragment_offsets() const { return fragment_offsets; }
+  //Sorted positions of the block found by the last has_next
+  const vector<Pointer>& get_block_positions() const { return block_positions; }
+
+  //Number of the fragments discarded so far to keep the coverage within the
+  //threshold. Their positions are kept, hence a column may remain empty.
+  Counter get_discarded_fragments() const { return discarded_fragments; }
 
 private:
   
@@ -86,22 +206,71 @@ private:
   Counter threshold_cov;
   bool unweighted;
   bool unique;
+  unsigned int parse_threads;
+
+  MappedFile input;
+  const char *cursor;
+  const char *limit;
+  unique_ptr<ChunkedWifParser> parser;
+
+  //A compressed input is decompressed (on a background thread) and parsed
+  //line by line, hence it is not split among the parsing threads
+  bool compressed;
+  unique_ptr<CompressedInput> decompressor;
 
-  ifstream input;
+  //Fragments already in memory (NULL if the input is a file)
+  const FragmentSet *fragment_set;
+  size_t next_set_fragment;
+
+  bool binary;
+  WifbFile wifb;
+  uint64_t next_binary_block;
+  uint64_t next_binary_fragment;
 
   bool end;
   bool already_got;
-  vector<Fragment> fragment_block;
-  Block block;
+  vector<EntryRead> fragment_entries;
+  vector<size_t> fragment_offsets;
+  vector<Pointer> block_positions;
+  shared_ptr<Block> block;
   unordered_set<Pointer> read_positions;
   Pointer max_position;
   Fragment last_fragment;
-  vector<Fragment::const_iterator> fragment_pointers;
+  size_t last_fragment_offset;
+  size_t fragment_offset;
+  uint64_t block_offset;
+  vector<size_t> fragment_pointers;
+
+  //Fragments kept by the read selection: the ones of the current block, or
+  //all the ones of the input in unique mode (empty if all are kept)
+  vector<bool> selected_fragments;
+  Counter discarded_fragments;
+
+  //State of the column sweep (unique mode). The pending fragment is read
+  //again from pending_offset when a saved sweep is restored.
+  vector<ActiveFragment> active_fragments;
+  Fragment pending_fragment;
+  bool has_pending_fragment;
+  uint64_t pending_offset;
+  readid_t next_read_id;
+  Pointer last_column_position;
 
   //Private Methods
   bool has_next_unique();
   bool has_next_nounique();
+  void load_binary_blocks(const uint64_t first_block, const uint64_t end_block);
+  void clear_fragments();
+  void add_fragment(const Fragment &read);
+  void sort_positions();
+  void select_block_fragments();
+  void select_input_fragments();
   void extract_block();
+  //Start parsing the textual input from the given byte offset
+  void restart_parsing(const size_t start);
+  bool next_fragment(Fragment &read);
+  bool read_fragment(Fragment &read);
+  bool read_pending_fragment();
+  void parse_fragment(const char *begin, const char *end, Fragment &read);
   void string_to_fragment(const string &line, Fragment &read);
   void add_positions(const Fragment &read);
 };
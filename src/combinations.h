@@ -38,6 +38,9 @@
 
 using namespace std;
 
+//Enumeration and ranking of the combinations of the reads of a column,
+//represented as bitsets of the type BitColumn (std::bitset of any width)
+template <typename BitColumn>
 class Combinations {
 
 public:
@@ -123,7 +126,7 @@ public:
 
 	
 
-  void get_combination(bitset<MAX_COVERAGE> &result)
+  void get_combination(BitColumn &result)
   {
     result.reset();
     result |= this->result;
@@ -137,32 +140,48 @@ public:
   }
 
 
-  unsigned int indexof(bitset<MAX_COVERAGE> comb)
+  //Colex rank of comb among the combinations with the same number of
+  //elements
+  unsigned int indexof(const BitColumn &comb)
+  {
+    return indexof(comb, comb.count(), comb.size());
+  }
+
+
+
+  //Colex rank of comb among the combinations of at most n_elements elements
+  //(with fewer elements first). The elements of comb are less than n_elements
+  unsigned int cumulative_indexof(const BitColumn &comb, const unsigned int n_elements)
+  {
+    const unsigned int k = comb.count();
+    unsigned int result = indexof(comb, k, n_elements);
+    if(k > 0)
+      {
+        result += binom_coeff::cumulative_binomial_coefficient(n_elements, k - 1);
+      }
+    return result;
+  }
+
+
+
+  //Reference versions of indexof and cumulative_indexof that visit the
+  //elements one by one (used by the ranking benchmark)
+  unsigned int indexof_by_elements(const BitColumn &comb)
   {
     int k = 0;
-    int c_k = 0;
-    int temp = 0;
     int result = 0;
-    //binomial_coefficient(32, 32);
-    while(comb.any())
+    for(size_t c_k = comb._Find_first(); c_k < comb.size(); c_k = comb._Find_next(c_k))
       {
-        temp = ffsl(comb.to_ulong());
-        c_k += temp;
         k++;
-        result += binom_coeff::binomial_coefficient(c_k - 1, k);
-        comb>>=(temp);
-        //std::cout << comb.to_string() << std::endl;
-        //std::cout << "   (" << c_k-1 << ", " << k << ") = " << binomial_coefficient(c_k - 1, k) << "     "; 
+        result += binom_coeff::binomial_coefficient(c_k, k);
       }
     return result;
   }
 
-
-
-  unsigned int cumulative_indexof(bitset<MAX_COVERAGE> comb, const unsigned int n_elements)
+  unsigned int cumulative_indexof_by_elements(const BitColumn &comb, const unsigned int n_elements)
   {
     unsigned int k = comb.count();
-    unsigned int result = indexof(comb);
+    unsigned int result = indexof_by_elements(comb);
     for(unsigned int i = 0; i < k; i++)
       {
         result += binom_coeff::binomial_coefficient(n_elements, i);
@@ -172,75 +191,65 @@ public:
 
 
 
+  //Combination of k elements out of n_elements of colex rank index (the
+  //inverse of indexof)
   void combinationof(const unsigned int index, const unsigned int n_elements,
-                     const unsigned int k, bitset<MAX_COVERAGE> &result)
+                     const unsigned int k, BitColumn &result)
   {
-    unsigned int iterator = n_elements - 1;
-    unsigned int counter = k;
-    unsigned int position = 0;
-          
-    result.reset();
+    unsigned int rest = index;
+    unsigned int element = n_elements;
 
-    while(counter > 0)
+    result.reset();
+    for(unsigned int i = k; i > 0; i--)
       {
-        if(index >= binom_coeff::binomial_coefficient(iterator, counter) + position)
-          {
-            position += binom_coeff::binomial_coefficient(iterator, counter);
-            result.set(iterator, 1);
-            counter--;
-          }
-        iterator--;
+        do {
+          element--;
+        } while(binom_coeff::binomial_coefficient(element, i) > rest);
+        result.set(element, 1);
+        rest -= binom_coeff::binomial_coefficient(element, i);
       }
   }
 
-        
 
+
+  //Combination of at most max_k elements out of n_elements of rank index
+  //(the inverse of cumulative_indexof)
   void cumulative_combinationof(const unsigned int index, const unsigned int n_elements,
-                                const unsigned int max_k, bitset<MAX_COVERAGE> &result)
+                                const unsigned int max_k, BitColumn &result)
   {
-    unsigned int position = binom_coeff::binomial_coefficient(n_elements, 0);
-    int counter = max_k - 1;
-
-    for(int i = counter; i > 0; i--)
-      {
-        position += binom_coeff::binomial_coefficient(n_elements, i);
-      }
-    while(index < position)
+    unsigned int k = 0;
+    while(k < max_k && index >= binom_coeff::cumulative_binomial_coefficient(n_elements, k))
       {
-        position -= binom_coeff::binomial_coefficient(n_elements, counter);
-        counter--;
+        k++;
       }
-    counter++;
-    combinationof(index - position, n_elements, counter, result);
+    const unsigned int position = (k > 0) ? binom_coeff::cumulative_binomial_coefficient(n_elements, k - 1) : 0;
+    combinationof(index - position, n_elements, k, result);
   }
 
 
         
-  void start_from(bitset<MAX_COVERAGE> comb, const unsigned int n_elements)
+  void start_from(const BitColumn &comb, const unsigned int n_elements)
   {
     int counter = 0;
-    int sum = 0;
-    int temp;
     int max_k = comb.count();
 
     initialize(n_elements, max_k);
     count = indexof(comb);
           
-    while(comb.any())
+    for(size_t pos = comb._Find_first(); pos < comb.size(); pos = comb._Find_next(pos))
       {
-        temp = ffsl(comb.to_ulong());
-        sum += temp;
-        comb>>=(temp);
-        this->combination[counter] = sum - 1;
-        result.set(sum - 1, 1);
+        this->combination[counter] = pos;
+        result.set(pos, 1);
         counter++;
       }
     combination[counter] = n_elements;
     combination[counter + 1] = 0;
           
           
+    //The next combination moves the first element that is not in its
+    //smallest position (as after initializing_step and basic_step)
     j = 0;
-    while(combination[j + 1] <= j)
+    while(j < max_k && combination[j] == j)
       {
         j++;
       }
@@ -257,7 +266,7 @@ public:
 
 
         
-  void cumulative_start_from(bitset<MAX_COVERAGE> comb, const unsigned int n_elements, 
+  void cumulative_start_from(const BitColumn &comb, const unsigned int n_elements, 
                              const unsigned int max_k)
   {
     start_from(comb, n_elements);
@@ -287,8 +296,8 @@ private:
   unsigned int count;
   bool end; 
   vector<int> combination;
-  bitset<MAX_COVERAGE> result;
-  bitset<MAX_COVERAGE> ending_mask;
+  BitColumn result;
+  BitColumn ending_mask;
   int j;
   int x;
   bool cumulative;
@@ -297,6 +306,30 @@ private:
 	
 	
 
+  //Colex rank of the k elements of comb, all less than n_elements. Up to
+  //RANK_MAX_K elements among the first 8 * RANK_CHUNKS ones (the common case)
+  //it is the sum of the precomputed ranks of the bytes of comb.
+  unsigned int indexof(const BitColumn &comb, const unsigned int k,
+                       const unsigned int n_elements)
+  {
+    if(k > binom_coeff::RANK_MAX_K || n_elements > 8 * binom_coeff::RANK_CHUNKS)
+      {
+        return indexof_by_elements(comb);
+      }
+    const unsigned long long word = comb.to_ullong();
+    const unsigned int chunks = (n_elements + 7) / 8;
+    unsigned int result = 0;
+    unsigned int preceding = 0;
+    for(unsigned int chunk = 0; chunk < chunks; ++chunk)
+      {
+        const unsigned int byte = (word >> (8 * chunk)) & 0xFF;
+        result += binom_coeff::byte_rank(chunk, preceding, byte);
+        preceding += __builtin_popcount(byte);
+      }
+    return result;
+  }
+
+
   void initializing_step()
   {
     j = 0;
@@ -0,0 +1,351 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#include "compressed_input.h"
+
+#include <string.h>
+#include <stdint.h>
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+
+#include <zlib.h>
+
+
+static inline
+uint32_t read_le32(const unsigned char *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+//Find the size of the BGZF block starting at p (the whole gzip member) and
+//the size of its header. Return false if p is not the start of a BGZF block.
+static
+bool bgzf_block_size(const unsigned char *p, const size_t available,
+                     size_t &block_size, size_t &header_size)
+{
+  //ID1, ID2, CM (deflate) and FLG with FEXTRA set
+  if(available < 18 || p[0] != 31 || p[1] != 139 || p[2] != 8 || (p[3] & 4) == 0) {
+    return false;
+  }
+  const size_t xlen = p[10] | (p[11] << 8);
+  if(12 + xlen > available) {
+    return false;
+  }
+
+  //The block size is in the 'BC' subfield of the extra field
+  size_t field = 12;
+  while(field + 4 <= 12 + xlen) {
+    const size_t slen = p[field + 2] | (p[field + 3] << 8);
+    if(p[field] == 'B' && p[field + 1] == 'C' && slen == 2 && field + 6 <= 12 + xlen) {
+      block_size = (p[field + 4] | (p[field + 5] << 8)) + 1;
+      header_size = 12 + xlen;
+      return true;
+    }
+    field += 4 + slen;
+  }
+  return false;
+}
+
+
+
+CompressedInput::CompressedInput(const char *data, const size_t size)
+  : data(data), size(size), bgzf(is_bgzf(data, size)),
+    finished(false), stopping(false), current_pos(0)
+{
+  producer = std::thread(&CompressedInput::decompress, this);
+}
+
+
+
+CompressedInput::~CompressedInput()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  buffer_freed.notify_all();
+  producer.join();
+}
+
+
+
+bool CompressedInput::has_magic(const char *data, const size_t size)
+{
+  return size >= 2
+    && static_cast<unsigned char>(data[0]) == 31
+    && static_cast<unsigned char>(data[1]) == 139;
+}
+
+
+
+bool CompressedInput::is_bgzf(const char *data, const size_t size)
+{
+  size_t block_size = 0;
+  size_t header_size = 0;
+  return bgzf_block_size(reinterpret_cast<const unsigned char*>(data), size,
+                         block_size, header_size);
+}
+
+
+
+void CompressedInput::decompress()
+{
+  std::vector<char> buffer;
+  std::string failure;
+  const bool ok = (bgzf)
+    ? decompress_bgzf(buffer, failure)
+    : decompress_gzip(buffer, failure);
+  if(ok && !buffer.empty()) {
+    push(buffer);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  error = failure;
+  finished = true;
+  buffer_ready.notify_all();
+}
+
+
+
+bool CompressedInput::decompress_gzip(std::vector<char> &buffer, std::string &failure)
+{
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  //Accept only the gzip format
+  if(inflateInit2(&stream, 15 + 16) != Z_OK) {
+    failure = "ERROR: cannot initialize the gzip decompressor";
+    return false;
+  }
+
+  //zlib takes at most 4GB of input at a time
+  const size_t max_input = 1 << 30;
+  size_t offset = 0;
+  size_t filled = 0;
+  buffer.resize(BUFFER_SIZE);
+
+  while(true) {
+    if(stream.avail_in == 0 && offset < size) {
+      const size_t length = std::min(size - offset, max_input);
+      stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data + offset));
+      stream.avail_in = length;
+      offset += length;
+    }
+    stream.next_out = reinterpret_cast<Bytef*>(&buffer[filled]);
+    stream.avail_out = BUFFER_SIZE - filled;
+
+    const int ret = inflate(&stream, Z_NO_FLUSH);
+    filled = BUFFER_SIZE - stream.avail_out;
+
+    if(ret == Z_STREAM_END) {
+      //A gzip file can be made of several members
+      if(stream.avail_in == 0 && offset == size) {
+        break;
+      }
+      inflateReset(&stream);
+    } else if(ret == Z_BUF_ERROR && stream.avail_in == 0 && offset == size) {
+      failure = "ERROR: the gzip input file is truncated";
+      inflateEnd(&stream);
+      return false;
+    } else if(ret != Z_OK && ret != Z_BUF_ERROR) {
+      failure = "ERROR: the gzip input file is corrupted";
+      inflateEnd(&stream);
+      return false;
+    }
+
+    if(filled == BUFFER_SIZE) {
+      if(!push(buffer)) {
+        inflateEnd(&stream);
+        return false;
+      }
+      filled = 0;
+      buffer.resize(BUFFER_SIZE);
+    }
+  }
+
+  inflateEnd(&stream);
+  buffer.resize(filled);
+  return true;
+}
+
+
+
+bool CompressedInput::decompress_bgzf(std::vector<char> &buffer, std::string &failure)
+{
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  //Raw deflate data: the gzip header and trailer are checked here
+  if(inflateInit2(&stream, -15) != Z_OK) {
+    failure = "ERROR: cannot initialize the gzip decompressor";
+    return false;
+  }
+
+  const unsigned char *input = reinterpret_cast<const unsigned char*>(data);
+  size_t offset = 0;
+  while(offset < size) {
+    size_t block_size = 0;
+    size_t header_size = 0;
+    if(!bgzf_block_size(input + offset, size - offset, block_size, header_size)
+       || block_size > size - offset || block_size < header_size + 8) {
+      failure = "ERROR: the BGZF input file is not well formatted";
+      inflateEnd(&stream);
+      return false;
+    }
+
+    const unsigned char *block = input + offset;
+    const uint32_t crc = read_le32(block + block_size - 8);
+    const uint32_t isize = read_le32(block + block_size - 4);
+
+    //Empty blocks (as the end-of-file marker) are inflated into a dummy byte
+    const size_t old_size = buffer.size();
+    buffer.resize(old_size + isize);
+    char dummy = 0;
+    Bytef *out = reinterpret_cast<Bytef*>((isize > 0) ? &buffer[old_size] : &dummy);
+
+    inflateReset(&stream);
+    stream.next_in = const_cast<Bytef*>(block + header_size);
+    stream.avail_in = block_size - header_size - 8;
+    stream.next_out = out;
+    stream.avail_out = isize;
+    const int ret = inflate(&stream, Z_FINISH);
+    if(ret != Z_STREAM_END || stream.avail_out != 0 || crc32(0, out, isize) != crc) {
+      failure = "ERROR: the BGZF input file is corrupted";
+      inflateEnd(&stream);
+      return false;
+    }
+    offset += block_size;
+
+    if(buffer.size() >= BUFFER_SIZE) {
+      if(!push(buffer)) {
+        inflateEnd(&stream);
+        return false;
+      }
+    }
+  }
+
+  inflateEnd(&stream);
+  return true;
+}
+
+
+
+bool CompressedInput::push(std::vector<char> &buffer)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while(!stopping && ready.size() >= MAX_BUFFERS) {
+    buffer_freed.wait(lock);
+  }
+  if(stopping) {
+    return false;
+  }
+
+  ready.push_back(std::vector<char>());
+  ready.back().swap(buffer);
+  buffer_ready.notify_all();
+  return true;
+}
+
+
+
+bool CompressedInput::pop()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while(ready.empty() && !finished) {
+    buffer_ready.wait(lock);
+  }
+  if(ready.empty()) {
+    if(!error.empty()) {
+      std::cerr << error << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    return false;
+  }
+
+  current.swap(ready.front());
+  ready.pop_front();
+  current_pos = 0;
+  buffer_freed.notify_all();
+  return true;
+}
+
+
+
+const char* CompressedInput::next_line(const char *&line_end)
+{
+  while(true) {
+    if(current_pos < current.size()) {
+      const char *begin = &current[current_pos];
+      const char *limit = &current[0] + current.size();
+      const char *eol = static_cast<const char*>(memchr(begin, '\n', limit - begin));
+      if(eol == NULL) {
+        //The line continues in the next buffer
+        carry.append(begin, limit);
+        current_pos = current.size();
+        continue;
+      }
+      current_pos = eol - &current[0] + 1;
+
+      if(!carry.empty()) {
+        carry.append(begin, eol);
+        joined.swap(carry);
+        carry.clear();
+        line_end = joined.data() + joined.size();
+        return joined.data();
+      }
+      //Empty lines are skipped
+      if(eol != begin) {
+        line_end = eol;
+        return begin;
+      }
+    } else if(!pop()) {
+      //The last line is not terminated by a newline
+      if(!carry.empty()) {
+        joined.swap(carry);
+        carry.clear();
+        line_end = joined.data() + joined.size();
+        return joined.data();
+      }
+      return NULL;
+    }
+  }
+}
+
+
+
+size_t CompressedInput::read(char *out, const size_t length)
+{
+  size_t copied = 0;
+  while(copied < length) {
+    if(current_pos == current.size() && !pop()) {
+      break;
+    }
+    const size_t available = std::min(current.size() - current_pos, length - copied);
+    memcpy(out + copied, &current[current_pos], available);
+    current_pos += available;
+    copied += available;
+  }
+  return copied;
+}
@@ -0,0 +1,110 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#ifndef COMPRESSED_INPUT_H
+#define COMPRESSED_INPUT_H
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <cstddef>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+//Streaming decompression of a gzip (or BGZF) file already in memory.
+//The data is decompressed by a background thread (so that decompression
+//overlaps with the rest of the computation) into a bounded queue of buffers,
+//and it is read line by line with next_line.
+//BGZF files (the blocked gzip format of samtools/htslib) are recognized by
+//their extra field and their blocks are inflated one at a time, using the
+//block sizes stored in the headers.
+class CompressedInput {
+
+public:
+
+  CompressedInput(const char *data, const size_t size);
+  ~CompressedInput();
+
+  //Return true if the data starts with the gzip magic bytes
+  static bool has_magic(const char *data, const size_t size);
+  //Return true if the data starts with a BGZF block
+  static bool is_bgzf(const char *data, const size_t size);
+
+  //Return the next line that is not empty, setting line_end to its end
+  //(excluded). Return NULL if there are no more lines. Errors found while
+  //decompressing are reported (and the program exits) after the lines
+  //preceding them have been returned.
+  const char* next_line(const char *&line_end);
+
+  //Copy the next length bytes of the decompressed data into out (the data
+  //is read either by lines or by bytes). Return the number of bytes copied,
+  //which is less than length only at the end of the data.
+  size_t read(char *out, const size_t length);
+
+  //Size of the decompressed buffers and maximum number of buffers in the queue
+  static const size_t BUFFER_SIZE = 1 << 20;
+  static const size_t MAX_BUFFERS = 8;
+
+private:
+
+  const char *data;
+  size_t size;
+  bool bgzf;
+
+  std::thread producer;
+  std::mutex mutex;
+  std::condition_variable buffer_ready;
+  std::condition_variable buffer_freed;
+  std::deque<std::vector<char> > ready;
+  bool finished;
+  bool stopping;
+  std::string error;
+
+  //Buffer currently read by next_line, part of a line that spans two
+  //buffers and the whole line once it is complete
+  std::vector<char> current;
+  size_t current_pos;
+  std::string carry;
+  std::string joined;
+
+  void decompress();
+  //Decompress the whole data, pushing the full buffers into the queue.
+  //Return false on errors (setting failure) or if the reader is being destroyed.
+  bool decompress_gzip(std::vector<char> &buffer, std::string &failure);
+  bool decompress_bgzf(std::vector<char> &buffer, std::string &failure);
+  //Move buffer into the queue. Return false if the reader is being destroyed.
+  bool push(std::vector<char> &buffer);
+  //Get the next buffer from the queue. Return false at the end of the data.
+  bool pop();
+
+  //Not copyable: the producer refers to this object
+  CompressedInput(const CompressedInput&);
+  CompressedInput& operator=(const CompressedInput&);
+};
+
+#endif
@@ -36,23 +36,21 @@
 #include "entry.h"
 
 std::ostream& operator<<(std::ostream& out, const Entry& e) {
-  out << "Entry(" << e.read_id << ',';
-  switch (e.allele_type) {
-    case Entry::MAJOR_ALLELE:
-      out << "MAJOR";
-      break;
-    case Entry::MINOR_ALLELE:
-      out << "MINOR";
-      break;
-    case Entry::BLANK:
-      out << "BLANK";
-      break;
-    case Entry::EQUAL_SCORES:
-      out << "EQUAL_SCORES";
-      break;
-    default:
-      assert(false);
+  out << "Entry(" << e.get_read_id() << ',';
+  if(e.is_gap()) {
+    out << "BLANK";
+  } else {
+    switch (e.get_allele_type()) {
+      case Entry::MAJOR_ALLELE:
+        out << "MAJOR";
+        break;
+      case Entry::MINOR_ALLELE:
+        out << "MINOR";
+        break;
+      default:
+        assert(false);
+    }
   }
-  out << ',' << ((int)e.phred_score) << ')';
+  out << ',' << e.get_phred_score() << ')';
   return out;
 }
@@ -35,52 +35,73 @@
 #define ENTRY_H
 
 #include <iostream>
+#include <stdint.h>
 
 typedef long int readid_t;
 
 #define SENTINEL_READID (-1)
 
+//Entries are packed in 32 bits: the phred score (limited to MAX_PHRED) in the
+//lowest 8 bits, then the allele bit, the gap bit and the read id plus one
+//(so that SENTINEL_READID is 0) in the highest ENTRY_READID_BITS bits
+#define ENTRY_READID_BITS 22
+#define MAX_READID ((readid_t(1) << ENTRY_READID_BITS) - 2)
+#define MAX_PHRED 255
+
 class Entry {
 
 public:
 
-  typedef enum { MAJOR_ALLELE = 0, MINOR_ALLELE = 1, BLANK = 2, EQUAL_SCORES = 3 } allele_t;
+  typedef enum { MAJOR_ALLELE = 0, MINOR_ALLELE = 1, BLANK = 2 } allele_t;
 
   Entry(readid_t r, allele_t m, unsigned int p)
-    :read_id(r), phred_score(p), allele_type(m), gap(false)
+    :packed(0)
   {
+    set_read_id(r);
     if(m == Entry::BLANK) {
-      allele_type = Entry::MAJOR_ALLELE;
-      gap = true;
-      phred_score = 0;
+      packed |= GAP_BIT;
+    } else {
+      set_phred_score(p);
+      packed |= (m == Entry::MINOR_ALLELE) ? MINOR_BIT : 0;
     }
   }
 
-  readid_t get_read_id() const { return read_id; }
-  allele_t get_allele_type() const { return allele_type; }
-  unsigned int get_phred_score() const { return phred_score; }
-  bool is_gap() const {return gap;}
+  readid_t get_read_id() const { return readid_t(packed >> READID_SHIFT) - 1; }
+  allele_t get_allele_type() const {
+    return (packed & MINOR_BIT) ? Entry::MINOR_ALLELE : Entry::MAJOR_ALLELE;
+  }
+  unsigned int get_phred_score() const { return packed & PHRED_MASK; }
+  bool is_gap() const { return (packed & GAP_BIT) != 0; }
 
-  void set_read_id(readid_t r) { read_id = r; }
+  //The read id must be at most MAX_READID (or SENTINEL_READID)
+  void set_read_id(readid_t r) {
+    packed = (packed & ~READID_MASK) | (uint32_t(r + 1) << READID_SHIFT);
+  }
   void set_allele_type(allele_t m) {
     if(m == Entry::BLANK) {
-      allele_type = Entry::MAJOR_ALLELE;
-      gap = true;
+      packed = (packed & ~MINOR_BIT) | GAP_BIT;
     } else {
-      allele_type = m;
-      gap = false;
+      packed = (packed & ~(MINOR_BIT | GAP_BIT)) | ((m == Entry::MINOR_ALLELE) ? MINOR_BIT : 0);
     }
   }
-  void set_phred_score(unsigned int p) { phred_score = p; }
-  void set_gap(bool g) {gap = g;}
+  //Scores greater than MAX_PHRED are stored as MAX_PHRED
+  void set_phred_score(unsigned int p) {
+    packed = (packed & ~PHRED_MASK) | ((p < MAX_PHRED) ? p : MAX_PHRED);
+  }
+  void set_gap(bool g) {
+    packed = (g) ? (packed | GAP_BIT) : (packed & ~GAP_BIT);
+  }
 
   friend std::ostream& operator<<(std::ostream& out, const Entry& e);
 
 private:
-  readid_t read_id;
-  unsigned int phred_score;
-  allele_t allele_type;
-  bool gap;
+  static const uint32_t PHRED_MASK = MAX_PHRED;
+  static const uint32_t MINOR_BIT = 1u << 8;
+  static const uint32_t GAP_BIT = 1u << 9;
+  static const unsigned int READID_SHIFT = 10;
+  static const uint32_t READID_MASK = ~uint32_t(0) << READID_SHIFT;
+
+  uint32_t packed;
 };
 
 #endif
@@ -0,0 +1,79 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#include "mapped_file.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+bool MappedFile::open(const std::string &filename)
+{
+  close();
+
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if(fd < 0) {
+    return false;
+  }
+
+  struct stat info;
+  if(fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+    ::close(fd);
+    return false;
+  }
+
+  data_size = info.st_size;
+  if(data_size > 0) {
+    void *addr = mmap(NULL, data_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(addr == MAP_FAILED) {
+      ::close(fd);
+      data_size = 0;
+      return false;
+    }
+    //The file is scanned front to back exactly once
+    madvise(addr, data_size, MADV_SEQUENTIAL);
+    data_ptr = static_cast<const char*>(addr);
+  }
+
+  //The mapping stays valid after closing the descriptor
+  ::close(fd);
+  opened = true;
+  return true;
+}
+
+
+
+void MappedFile::close()
+{
+  if(data_ptr != NULL) {
+    munmap(const_cast<char*>(data_ptr), data_size);
+  }
+  data_ptr = NULL;
+  data_size = 0;
+  opened = false;
+}
@@ -0,0 +1,64 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+
+//Read-only memory mapping of a whole file.
+//An empty file is mapped as an empty range (data() == NULL, size() == 0).
+class MappedFile {
+
+public:
+
+  MappedFile()
+    : data_ptr(NULL), data_size(0), opened(false)
+  {}
+
+  ~MappedFile() { close(); }
+
+  bool open(const std::string &filename);
+  void close();
+
+  bool is_open() const { return opened; }
+  const char* data() const { return data_ptr; }
+  size_t size() const { return data_size; }
+
+private:
+
+  const char *data_ptr;
+  size_t data_size;
+  bool opened;
+
+  //Not copyable: the mapping is owned
+  MappedFile(const MappedFile&);
+  MappedFile& operator=(const MappedFile&);
+};
+
+#endif
@@ -0,0 +1,115 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#include "mask_batch.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define MASK_BATCH_AVX2
+#endif
+
+//The kernels read the costs as their raw values
+static_assert(sizeof(Cost) == sizeof(Cost::cost_t), "a Cost must be its raw value");
+
+const unsigned int MaskBatch::LANES;
+const unsigned int MaskBatch::NO_CHOICE;
+const unsigned int MaskBatch::ZERO_INDICES[MaskBatch::LANES] = { 0 };
+
+void
+MaskBatch::relax_portable(const Cost *row, const unsigned int *index, unsigned int lanes,
+                          const Cost *weight, const Cost &extra, Cost *cost,
+                          unsigned int *choice, const unsigned int &value) {
+  for(unsigned int b = 0; lanes != 0; ++b, lanes >>= 1) {
+    if(lanes & 1) {
+      const Cost temp = row[index[b]] + weight[b] + extra;
+      if(temp < cost[b]) {
+        cost[b] = temp;
+        choice[b] = value;
+      }
+    }
+  }
+}
+
+#ifdef MASK_BATCH_AVX2
+
+//a + b saturated to INFTY (all ones): a + min(b, INFTY - a)
+__attribute__((target("avx2")))
+static inline __m256i
+saturated_add(const __m256i &a, const __m256i &b) {
+  const __m256i ones = _mm256_set1_epi32(-1);
+  return _mm256_add_epi32(a, _mm256_min_epu32(b, _mm256_xor_si256(a, ones)));
+}
+
+//Eight lanes at a time, with the lookups of the lanes that are not in lanes
+//masked (they give INFTY, which never decreases a cost)
+__attribute__((target("avx2")))
+void
+MaskBatch::relax_avx2(const Cost *row, const unsigned int *index, unsigned int lanes,
+                      const Cost *weight, const Cost &extra, Cost *cost,
+                      unsigned int *choice, const unsigned int &value) {
+  const __m256i ones = _mm256_set1_epi32(-1);
+  const __m256i sign = _mm256_set1_epi32(0x80000000);
+  const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+  const __m256i extras = _mm256_set1_epi32(*reinterpret_cast<const int*>(&extra));
+  const __m256i values = _mm256_set1_epi32(value);
+  for(unsigned int b = 0; b < LANES; b += 8, lanes >>= 8) {
+    if((lanes & 0xFF) == 0) {
+      continue;
+    }
+    const __m256i active = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(lanes), bits), bits);
+    const __m256i indices = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(index + b));
+    const __m256i lookups = _mm256_mask_i32gather_epi32(ones, reinterpret_cast<const int*>(row),
+                                                        indices, active, 4);
+    const __m256i weights = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weight + b));
+    const __m256i temps = saturated_add(saturated_add(lookups, weights), extras);
+    const __m256i costs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cost + b));
+    //Unsigned temps < costs
+    const __m256i less = _mm256_cmpgt_epi32(_mm256_xor_si256(costs, sign), _mm256_xor_si256(temps, sign));
+    const __m256i choices = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(choice + b));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(cost + b), _mm256_blendv_epi8(costs, temps, less));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(choice + b), _mm256_blendv_epi8(choices, values, less));
+  }
+}
+
+MaskBatch::relax_t
+MaskBatch::relax_kernel() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") ? relax_avx2 : relax_portable;
+}
+
+#else
+
+MaskBatch::relax_t
+MaskBatch::relax_kernel() {
+  return relax_portable;
+}
+
+#endif
+
+const char*
+MaskBatch::relax_kernel_name() {
+  return (relax_kernel() == relax_portable) ? "portable" : "AVX2";
+}
@@ -0,0 +1,111 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#ifndef MASK_BATCH_H
+#define MASK_BATCH_H
+
+#include <vector>
+
+#include "basic_types.h"
+
+//A batch of correction masks of column j, evaluated together by the DP: the
+//masks are generated (with their weights and the indices of their
+//projections) one after the other, then the lookups of the batch in the
+//previsions of j are reduced lane by lane, and finally the previsions of the
+//successive columns are updated in the order of the masks (hence the ties
+//are broken as if the masks were evaluated one at a time).
+class MaskBatch {
+
+public:
+
+  static const unsigned int LANES = 16;
+
+  //Choice of the lanes that have no finite cost
+  static const unsigned int NO_CHOICE = 0;
+
+  //The index 0 for all the lanes
+  static const unsigned int ZERO_INDICES[LANES];
+
+  //Columns of the window that a mask of j looks up (the previous ones) or
+  //updates (the successive ones), the same for all the masks of j. The
+  //lookups of a previous column cost at least least (plus the weight of the
+  //mask).
+  struct neighbour_t {
+    Counter distance;
+    Counter max_corrections;
+    Cost cumulative_homo;
+    Cost *row;
+    Cost least;
+  };
+  std::vector<neighbour_t> previous;
+  std::vector<neighbour_t> successive;
+
+  //Masks in the batch, their weights and, for each lane, the minimum cost
+  //and the choice that gives it
+  unsigned int size;
+  Cost weight[LANES];
+  Cost cost[LANES];
+  unsigned int choice[LANES];
+
+  //Indices (lane by lane) of the projections on the previous columns and
+  //of their complements (the choices 1 + 2 * i and 2 + 2 * i for the i-th
+  //previous column), with the lanes where they are feasible, and indices of
+  //the projections on the successive columns
+  std::vector<unsigned int> previous_index;
+  std::vector<unsigned int> previous_lanes;
+  std::vector<unsigned int> successive_index;
+
+  MaskBatch()
+    : size(0)
+  {}
+
+  //Shape the batch for a column with the given neighbours
+  void reset_lanes() {
+    previous_index.resize(2 * previous.size() * LANES);
+    previous_lanes.assign(2 * previous.size(), 0);
+    successive_index.resize(successive.size() * LANES);
+    size = 0;
+  }
+
+  //For each of the lanes of the bit set lanes: cost = min(cost, row[index] +
+  //weight + extra), and choice = value if the cost decreases
+  typedef void (*relax_t)(const Cost *row, const unsigned int *index, unsigned int lanes,
+                          const Cost *weight, const Cost &extra, Cost *cost,
+                          unsigned int *choice, const unsigned int &value);
+
+  //The relax kernel of the CPU (AVX2 if it supports it)
+  static relax_t relax_kernel();
+  static const char* relax_kernel_name();
+
+  static void relax_portable(const Cost *row, const unsigned int *index, unsigned int lanes,
+                             const Cost *weight, const Cost &extra, Cost *cost,
+                             unsigned int *choice, const unsigned int &value);
+  static void relax_avx2(const Cost *row, const unsigned int *index, unsigned int lanes,
+                         const Cost *weight, const Cost &extra, Cost *cost,
+                         unsigned int *choice, const unsigned int &value);
+};
+
+#endif
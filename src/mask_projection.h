@@ -0,0 +1,131 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#ifndef MASK_PROJECTION_H
+#define MASK_PROJECTION_H
+
+#include <vector>
+
+#include "basic_types.h"
+#include "combinations.h"
+
+//Projection of the correction mask of column j on the reads it shares with
+//another column of the window, split (as the indices of the prevision table)
+//into the shared reads without and with a gap. The projection is updated
+//read by read when the mask changes, hence only the reads that change cost
+//time, whatever the coverage of the columns. Masks of at most 64 reads can
+//also be projected at once by a gather kernel (see bit_kernels.h).
+template <typename BitColumn>
+class MaskProjection {
+
+public:
+
+  //The i-th shared read is the read indexer[i] of column j (up to the first
+  //-1), and it has a gap if gaps[i] is set. The projection of the empty mask
+  //of column j is initial.
+  void reset(const std::vector<Pointer> &indexer, const BitColumn &gaps,
+             const BitColumn &initial, const Counter &cov_j) {
+    slots.assign(cov_j, -1);
+    no_gaps.reset();
+    with_gaps.reset();
+    num_no_gaps = 0;
+    num_gaps = 0;
+    no_gaps_selector = 0;
+    gaps_selector = 0;
+    for(Counter i = 0; i < indexer.size() && indexer[i] != -1; ++i) {
+      const unsigned long long read = (indexer[i] < 64) ? 1ULL << indexer[i] : 0;
+      if(gaps[i]) {
+        with_gaps.set(num_gaps, initial[i]);
+        slots[indexer[i]] = (num_gaps++ << 1) | 1;
+        gaps_selector |= read;
+      } else {
+        no_gaps.set(num_no_gaps, initial[i]);
+        slots[indexer[i]] = num_no_gaps++ << 1;
+        no_gaps_selector |= read;
+      }
+    }
+    initial_no_gaps = no_gaps;
+    initial_gaps = with_gaps;
+  }
+
+  //Read r of column j has been flipped in the mask
+  void flip(const Counter &r) {
+    const Pointer slot = slots[r];
+    if(slot >= 0) {
+      if(slot & 1) {
+        with_gaps.flip(slot >> 1);
+      } else {
+        no_gaps.flip(slot >> 1);
+      }
+    }
+  }
+
+  //Project the whole mask of column j (of at most 64 reads) with the gather
+  //kernel Bits
+  template <typename Bits>
+  void gather(const BitColumn &mask) {
+    const unsigned long long reads = mask.to_ullong();
+    no_gaps = initial_no_gaps ^ BitColumn(Bits::gather(reads, no_gaps_selector));
+    with_gaps = initial_gaps ^ BitColumn(Bits::gather(reads, gaps_selector));
+  }
+
+  //Number of corrected shared reads without a gap, in the projection or in
+  //its complement
+  Counter corrections() const { return no_gaps.count(); }
+  Counter complement_corrections() const { return num_no_gaps - no_gaps.count(); }
+
+  //Index of the projection (or of its complement) in the prevision table
+  unsigned int index(Combinations<BitColumn> &generator) const {
+    return (generator.cumulative_indexof(no_gaps, num_no_gaps) << num_gaps) |
+      (unsigned int)with_gaps.to_ulong();
+  }
+  unsigned int complement_index(Combinations<BitColumn> &generator) const {
+    BitColumn ones;
+    ones.flip();
+    const BitColumn complement_no_gaps = no_gaps ^ (ones << num_no_gaps).flip();
+    const BitColumn complement_gaps = with_gaps ^ (ones << num_gaps).flip();
+    return (generator.cumulative_indexof(complement_no_gaps, num_no_gaps) << num_gaps) |
+      (unsigned int)complement_gaps.to_ulong();
+  }
+
+private:
+
+  //For each read of column j, the index of the shared read among the ones
+  //without (even) or with (odd) a gap, or -1
+  std::vector<Pointer> slots;
+  BitColumn no_gaps;
+  BitColumn with_gaps;
+  Counter num_no_gaps;
+  Counter num_gaps;
+  //The shared reads of column j without and with a gap, and the projection
+  //of its empty mask
+  unsigned long long no_gaps_selector;
+  unsigned long long gaps_selector;
+  BitColumn initial_no_gaps;
+  BitColumn initial_gaps;
+};
+
+#endif
@@ -0,0 +1,146 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#ifndef MASK_RANGE_H
+#define MASK_RANGE_H
+
+#include <vector>
+#include <algorithm>
+
+#include "basic_types.h"
+#include "combinations.h"
+#include "mask_projection.h"
+#include "mask_batch.h"
+
+//A range of the correction masks of column j (in the order in which the DP
+//enumerates them) evaluated by one of the threads of the DP. Its masks are
+//evaluated as by the serial DP, but the previsions that they make for the
+//successive columns are kept in the range, and only the first mask of
+//minimum cost is kept for OPT: the ranges are then merged in their order,
+//with the same strict comparisons, hence with the same ties as the serial DP.
+template <typename BitColumn>
+class MaskRange {
+
+public:
+
+  //Masks of a column below which a range is not worth the synchronization
+  //of the threads
+  static const unsigned long long MIN_MASKS = 4096;
+
+  //A choice for D[j, C'j], as written in the backtrace table
+  struct choice_t {
+    Counter jump;
+    Counter index;
+    bool haplotypes;
+    bool new_block;
+  };
+
+  //Ranks of the first combination of the reads without gaps and of the one
+  //after the last
+  Counter begin;
+  Counter end;
+
+  //Working memory of the thread
+  Combinations<BitColumn> generator;
+  std::vector<MaskProjection<BitColumn> > projections;
+  MaskBatch batch;
+
+  //The first mask of minimum cost, with its cost and its choice
+  bool solution_existence;
+  Cost best;
+  choice_t best_choice;
+  BitColumn best_mask;
+
+  //Previsions for the i-th successive column and their choices: only the
+  //first touched[i] ones can be finite
+  std::vector<std::vector<Cost> > previsions;
+  std::vector<std::vector<choice_t> > choices;
+  std::vector<Counter> touched;
+
+  //Masks generated, and the ones among them whose lookups were pruned by
+  //the lower bound; lookups of the previous columns made by the masks, and
+  //the ones pruned by the lower bound
+  unsigned long long evaluated;
+  unsigned long long bounded;
+  unsigned long long lookups;
+  unsigned long long bounded_lookups;
+
+  MaskRange()
+    : begin(0), end(0), solution_existence(false), best(Cost::INFTY), evaluated(0), bounded(0),
+      lookups(0), bounded_lookups(0)
+  {}
+
+  //Start the range [begin, end) of a column with the given number of
+  //successive columns
+  void reset(const Counter &begin, const Counter &end, const size_t &successive) {
+    this->begin = begin;
+    this->end = end;
+    solution_existence = false;
+    best = Cost::INFTY;
+    evaluated = 0;
+    bounded = 0;
+    lookups = 0;
+    bounded_lookups = 0;
+    if(previsions.size() < successive) {
+      previsions.resize(successive);
+      choices.resize(successive);
+    }
+    touched.assign(successive, 0);
+  }
+
+  //Prevision kept for the i-th successive column
+  Cost kept(const size_t &i, const Counter &index) const {
+    return (index < touched[i]) ? previsions[i][index] : Cost::INFTY;
+  }
+
+  //Keep the prevision cost (if it is less than the previous one) for the
+  //i-th successive column
+  void keep(const size_t &i, const Counter &index, const Cost &cost, const choice_t &choice) {
+    std::vector<Cost> &row = previsions[i];
+    if(index >= row.size()) {
+      if(!(cost < Cost::INFTY)) {
+        return;
+      }
+      row.resize(std::max((size_t)index + 1, 2 * row.size()), Cost::INFTY);
+      choices[i].resize(row.size());
+    }
+    if(cost < row[index]) {
+      row[index] = cost;
+      choices[i][index] = choice;
+      touched[i] = std::max(touched[i], index + 1);
+    }
+  }
+
+  //Set the previsions kept to infinite, for the next column
+  void clear_previsions() {
+    for(size_t i = 0; i < touched.size(); ++i) {
+      std::fill(previsions[i].begin(), previsions[i].begin() + touched[i], Cost::INFTY);
+      touched[i] = 0;
+    }
+  }
+};
+
+#endif
@@ -32,20 +32,33 @@ void ColumnReader1::read_block()
   unsigned int count_minor = 0;
   unsigned int count_major = 0;
   num_col = 0;
+  total_cols = 0;
+
+  is_homozygous.clear();
+  kind.clear();
+  is_uncovered.clear();
+
+  if(stream != NULL) {
+    stream->restart_columns();
+  }
+
+  Block::const_iterator ib;
+  if(stream == NULL) {
+    ib = block->begin();
+  }
+  while((stream != NULL) ? stream->next_column(stream_column) : (ib != block->end())) {
+    const Column &column = (stream != NULL) ? stream_column : *ib;
 
-  std::vector<bool>::iterator ik = kind.begin();
-  std::vector<bool>::iterator ii = is_homozygous.begin();
-  for(Block::const_iterator ib = block.begin();
-      ib != block.end();
-      ++ib) {
-    
     ++num_col;
+    ++total_cols;
     
     count_minor = 0;
     count_major = 0;
-    for(Column::const_iterator ic = (*ib).begin();
-        ic != (*ib).end();
+    bool uncovered = true;
+    for(Column::const_iterator ic = column.begin();
+        ic != column.end();
         ++ic) {
+      uncovered = uncovered && (*ic).is_gap();
             
       if(!(*ic).is_gap() & ((*ic).get_phred_score() != 0)) {
         if ((*ic).get_allele_type() == Entry::MAJOR_ALLELE) {
@@ -59,26 +72,93 @@ void ColumnReader1::read_block()
       }
     }
 
+    is_homozygous.push_back(false);
+    kind.push_back(false);
+    is_uncovered.push_back(uncovered);
     if(count_minor == 0 || count_major == 0) {
-      *ii = true;
-      *ik = (count_major != 0)? false : true; 
-      if(jump_homozygous) {
-        --num_col;
-      }
+      is_homozygous.back() = true;
+      kind.back() = (count_major != 0)? false : true; 
+    }
+    if(is_jumped(is_homozygous.size() - 1)) {
+      --num_col;
     }
 
-    ++ii;
-    ++ik;
+    if(stream == NULL) {
+      ++ib;
+    }
   }
   
-  first = block.begin();
+  first = 0;
+
+  while ((first < total_cols) && is_jumped(first)) {
+    ++first;
+  }
+}
+
+
+
+void ColumnReader1::restart()
+{
+  icol = first;
+  started = false;
+  next = first < total_cols;
+
+  if(stream != NULL) {
+    stream->restart_columns();
+    stream_icol = 0;
+    //Move the stream on the first column
+    if(next) {
+      advance_stream();
+    }
+  }
+}
+
 
 
-  if(jump_homozygous) {
-    while ((first != block.end()) && is_homozygous[first - block.begin()]) {
-      ++first;
+void ColumnReader1::save_position(position_t &position) const
+{
+  position.icol = icol;
+  position.started = started;
+  position.next = next;
+  position.stream_icol = stream_icol;
+  if(stream != NULL && stream->is_sweep_restorable()) {
+    stream->save_sweep(position.sweep);
+  }
+}
+
+
+
+void ColumnReader1::restore_position(const position_t &position)
+{
+  if(stream != NULL) {
+    if(stream->is_sweep_restorable()) {
+      stream->restore_sweep(position.sweep);
+      stream_icol = position.stream_icol;
+    } else {
+      restart();
+      if(position.stream_icol > stream_icol) {
+        icol = position.stream_icol - 1;
+        advance_stream();
+      }
     }
   }
+  icol = position.icol;
+  started = position.started;
+  next = position.next;
+}
+
+
+
+//Read from the stream the column of index icol
+bool ColumnReader1::advance_stream()
+{
+  while(stream_icol <= icol) {
+    if(!stream->next_column(stream_column)) {
+      return false;
+    }
+    ++stream_icol;
+  }
+  return true;
 }
 
 
@@ -89,17 +169,19 @@ bool ColumnReader1::has_next()
     return false;
   } else {
     if(started) {
-      ++iblock;
-      if(jump_homozygous) {
-        while ((iblock != block.end()) && is_homozygous[iblock - block.begin()]) {
-          ++iblock;
-        }
-      } 
+      ++icol;
+      while ((icol < total_cols) && is_jumped(icol)) {
+        ++icol;
+      }
     } else {
       started = true;
     }
   
-    next = iblock != block.end();
+    next = icol < total_cols;
+
+    if(next && stream != NULL) {
+      advance_stream();
+    }
 
     return next;
   }
@@ -107,15 +189,14 @@ bool ColumnReader1::has_next()
 
 
 
-Column ColumnReader1::get_next()
+const Column& ColumnReader1::get_next()
 {
+  static const Column empty_column;
   if(next) {
-    if((*iblock).size() == 0) {
-      std::cout << "ERRORRRRRRRRRRRRRRR" << std::endl;
-      exit(-1);
-    }
-    return *iblock;
+    //A column is empty if all the fragments spanning it have been discarded
+    //by the read selection
+    return (stream != NULL) ? stream_column : (*block)[icol];
   } else {
-    return Column(0, Entry(-1, Entry::BLANK, 0));
+    return empty_column;
   }
 }
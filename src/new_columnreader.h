@@ -29,6 +29,7 @@
 
 #include "basic_types.h"
 #include "entry.h"
+#include "blockreader.h"
 
 
 
@@ -36,52 +37,101 @@ class ColumnReader1 {
 
 public:
 
-  ColumnReader1(const Block &b, const bool &jump) 
+  //If jump is true, the homozygous columns are skipped. If
+  //jump_uncovered is true, the columns without entries that are not gaps
+  //(left by the read selection) are skipped as well.
+  //The block b is not copied, hence it must outlive the reader
+  ColumnReader1(const Block &b, const bool &jump, const bool &jump_uncovered = false) 
     {
-      block = b;
+      block = &b;
+      stream = NULL;
       jump_homozygous = jump;
-      
-      is_homozygous = std::vector<bool> (block.size(), false);
-      kind = std::vector<bool> (block.size(), false);
-      
+      this->jump_uncovered = jump_uncovered;
+
       read_block();
       
       restart();
     }
 
+  //Read the next block of blockreader, sharing its storage with the other
+  //readers of the same block. In unique mode the columns are not
+  //stored but they are computed again by the sweep of blockreader at every
+  //restart, and only the homozygosity of each column is kept.
+  ColumnReader1(BlockReader &blockreader, const bool &jump, const bool &jump_uncovered = false)
+    {
+      if(blockreader.is_streaming()) {
+        block = NULL;
+        stream = &blockreader;
+      } else {
+        shared_block = blockreader.get_block();
+        block = shared_block.get();
+        stream = NULL;
+      }
+      jump_homozygous = jump;
+      this->jump_uncovered = jump_uncovered;
+
+      read_block();
+
+      restart();
+    }
+
   ~ColumnReader1() { }
 
   bool has_next();
-  Column get_next();
-
-  void restart() { 
-    iblock = first;
-    started = false;
-    next = first != block.end();
-  }
+  //The column is valid until the next call of has_next or restart
+  const Column& get_next();
+
+  void restart();
+
+  //Position of the reader between two calls of has_next. In unique mode it
+  //includes the state of the sweep, unless the input is compressed (then
+  //the sweep is run again up to the position).
+  struct position_t {
+    size_t icol;
+    bool started;
+    bool next;
+    size_t stream_icol;
+    BlockReader::sweep_state_t sweep;
+  };
+  void save_position(position_t &position) const;
+  void restore_position(const position_t &position);
 
   Counter num_cols() { return num_col; }
 
-  bool was_homozygous() {return is_homozygous[iblock - block.begin()]; }
-  bool homozigosity() {return kind[iblock - block.begin()]; }
+  bool was_homozygous() {return is_homozygous[icol]; }
+  bool homozigosity() {return kind[icol]; }
+  bool was_uncovered() {return is_uncovered[icol]; }
     
 
 private:
   
-  Block block;
+  const Block *block;
+  std::shared_ptr<const Block> shared_block;
+  BlockReader *stream;
   Counter num_col;
+  Counter total_cols;
   bool jump_homozygous;
+  bool jump_uncovered;
 
-  Block::const_iterator iblock;
-  Block::const_iterator first;
+  //Index of the current column (among all the columns of the block)
+  size_t icol;
+  size_t first;
   bool started;
   bool next;
 
+  //Column read from the stream and its index
+  Column stream_column;
+  size_t stream_icol;
+
   std::vector<bool> is_homozygous;
   std::vector<bool> kind;
+  std::vector<bool> is_uncovered;
 
   void read_block();
+  bool is_jumped(const size_t i) const {
+    return (jump_homozygous && is_homozygous[i]) || (jump_uncovered && is_uncovered[i]);
+  }
+  bool advance_stream();
 };
 
 #endif
-
@@ -0,0 +1,217 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#ifndef ORDERED_POOL_H
+#define ORDERED_POOL_H
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//A pool of threads that solve the jobs submitted by another thread, in any
+//order, while the submitting thread collects them in the order in which they
+//were submitted (a reorder buffer). At most capacity jobs are in flight, so
+//that the submitting thread does not read far ahead of the slowest job.
+//
+//Each job comes with an estimate of its cost: a job is queued by the thread
+//with the least queued cost, each thread solves its costliest queued job
+//first, and a thread with an empty queue steals the costliest job of the
+//thread with the most queued cost. Hence the longest jobs of the window are
+//started first, and no thread is idle while jobs are queued.
+template <typename Job>
+class OrderedPool {
+
+public:
+
+  //Solution of a job by one of the threads of the pool (numbered from 0)
+  struct solver_t {
+    virtual void solve(Job &job, const unsigned int thread) = 0;
+    virtual ~solver_t() {}
+  };
+
+  OrderedPool(const unsigned int num_threads, const size_t capacity, solver_t &solver)
+    : capacity(capacity), solver(solver), queues(num_threads), queued_cost(num_threads, 0),
+      stolen_jobs(0), stopping(false)
+  {
+    for(unsigned int thread = 0; thread < num_threads; ++thread) {
+      workers.push_back(std::thread(&OrderedPool::worker, this, thread));
+    }
+  }
+
+  ~OrderedPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    job_submitted.notify_all();
+    for(size_t i = 0; i < workers.size(); ++i) {
+      if(workers[i].joinable()) {
+        workers[i].join();
+      }
+    }
+  }
+
+  //Drop the queued jobs and wait for the threads to end the ones they are
+  //solving (the jobs in flight are never collected)
+  void cancel() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for(size_t i = 0; i < queues.size(); ++i) {
+        queues[i].clear();
+        queued_cost[i] = 0;
+      }
+      stopping = true;
+    }
+    job_submitted.notify_all();
+    for(size_t i = 0; i < workers.size(); ++i) {
+      workers[i].join();
+    }
+  }
+
+  //True if a job has to be collected before the next one is submitted
+  bool full() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return in_flight.size() >= capacity;
+  }
+
+  //Submit job, of the given estimated cost (the job is not owned by the pool)
+  void submit(Job *job, const unsigned long long &cost) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      in_flight.push_back(entry_t(job, cost));
+      entry_t *entry = &in_flight.back();
+      size_t thread = 0;
+      for(size_t i = 1; i < queues.size(); ++i) {
+        if(queued_cost[i] < queued_cost[thread]) {
+          thread = i;
+        }
+      }
+      //The jobs of the same cost are kept in the order of submission
+      typename std::deque<entry_t*>::iterator position = queues[thread].begin();
+      while(position != queues[thread].end() && (*position)->cost >= cost) {
+        ++position;
+      }
+      queues[thread].insert(position, entry);
+      queued_cost[thread] += cost;
+    }
+    job_submitted.notify_all();
+  }
+
+  //The oldest job in flight, as soon as it is solved (NULL if there is none)
+  Job* collect() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if(in_flight.empty()) {
+      return NULL;
+    }
+    while(!in_flight.front().solved) {
+      job_solved.wait(lock);
+    }
+    Job *job = in_flight.front().job;
+    in_flight.pop_front();
+    return job;
+  }
+
+  //Number of jobs solved by a thread other than the one that queued them
+  size_t stolen() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stolen_jobs;
+  }
+
+private:
+
+  struct entry_t {
+    Job *job;
+    unsigned long long cost;
+    bool solved;
+
+    entry_t(Job *job, const unsigned long long &cost)
+      : job(job), cost(cost), solved(false)
+    {}
+  };
+
+  const size_t capacity;
+  solver_t &solver;
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable job_submitted;
+  std::condition_variable job_solved;
+
+  //Jobs in the order of submission (the entries of a deque are not moved by
+  //push_back and pop_front), and the ones queued by each thread, the
+  //costliest first, with their total cost
+  std::deque<entry_t> in_flight;
+  std::vector<std::deque<entry_t*> > queues;
+  std::vector<unsigned long long> queued_cost;
+  size_t stolen_jobs;
+  bool stopping;
+
+  //The next job of thread (NULL if no job is queued)
+  entry_t* take(const unsigned int thread) {
+    size_t victim = thread;
+    if(queues[thread].empty()) {
+      for(size_t i = 0; i < queues.size(); ++i) {
+        if(!queues[i].empty() && (queues[victim].empty() || queued_cost[i] > queued_cost[victim])) {
+          victim = i;
+        }
+      }
+      if(queues[victim].empty()) {
+        return NULL;
+      }
+      ++stolen_jobs;
+    }
+    entry_t *entry = queues[victim].front();
+    queues[victim].pop_front();
+    queued_cost[victim] -= entry->cost;
+    return entry;
+  }
+
+  void worker(const unsigned int thread) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true) {
+      entry_t *entry = take(thread);
+      while(entry == NULL && !stopping) {
+        job_submitted.wait(lock);
+        entry = take(thread);
+      }
+      if(entry == NULL) {
+        return;
+      }
+      lock.unlock();
+      solver.solve(*entry->job, thread);
+      lock.lock();
+      entry->solved = true;
+      job_solved.notify_one();
+    }
+  }
+
+  //Not copyable: the workers refer to this object
+  OrderedPool(const OrderedPool&);
+  OrderedPool& operator=(const OrderedPool&);
+};
+
+#endif
@@ -0,0 +1,135 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#ifndef PREVISION_TABLE_H
+#define PREVISION_TABLE_H
+
+#include <stdlib.h>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "basic_types.h"
+
+#define CACHE_LINE_SIZE 64
+
+//The previsions of the DP: for each column of the window (the destination
+//of the prevision) and each distance q of the column that makes it, a row of
+//costs indexed by the combinations of the reads shared by the two columns.
+//The rows of all the columns are stored in a single slab, one column after
+//the other, and each row starts at a cache line.
+class PrevisionTable {
+
+public:
+
+  PrevisionTable()
+    : num_columns(0), row_offsets(1, 0), column_size(0), capacity(0), slab(NULL)
+  {}
+
+  //Shape the table as a new one, with all the costs INFTY: each column has a
+  //row for each distance q < columns, of row_sizes[q] costs. The slab is
+  //allocated again only if it is too small.
+  void reset(const Counter &columns, const std::vector<Counter> &row_sizes) {
+    num_columns = columns;
+    row_offsets.assign(columns + 1, 0);
+    const Counter line = CACHE_LINE_SIZE / sizeof(Cost);
+    for(Counter q = 0; q < columns; ++q) {
+      row_offsets[q + 1] = row_offsets[q] + (row_sizes[q] + line - 1) / line * line;
+    }
+    column_size = row_offsets.back();
+
+    const size_t size = (size_t)num_columns * column_size;
+    if(size > capacity || slab == NULL) {
+      free(slab);
+      slab = NULL;
+      capacity = std::max(size, (size_t)1);
+      if(posix_memalign((void**)&slab, CACHE_LINE_SIZE, capacity * sizeof(Cost)) != 0) {
+        std::cerr << "ERROR: failing allocating the prevision table ("
+                  << size * sizeof(Cost) << " bytes)" << std::endl;
+        exit(EXIT_FAILURE);
+      }
+    }
+    std::uninitialized_fill(slab, slab + size, Cost::INFTY);
+  }
+
+  ~PrevisionTable() { free(slab); }
+
+  //Number of columns of the window
+  Counter size() const { return num_columns; }
+
+  //Row of the previsions made for column at distance q
+  Cost* row(const Pointer &column, const Counter &q) {
+    return slab + (size_t)column * column_size + row_offsets[q];
+  }
+
+  //Size in bytes of the costs
+  size_t memory() const { return (size_t)num_columns * column_size * sizeof(Cost); }
+
+  //The costs of the table that are not INFTY, as runs of consecutive costs
+  struct snapshot_t {
+    std::vector<std::pair<size_t, size_t> > runs;
+    std::vector<Cost> costs;
+  };
+
+  //Copy the costs out of (or back into) the table
+  void save(snapshot_t &snapshot) const {
+    snapshot.runs.clear();
+    snapshot.costs.clear();
+    const size_t size = (size_t)num_columns * column_size;
+    for(size_t i = 0; i < size; ++i) {
+      if(!(slab[i] == Cost::INFTY)) {
+        if(snapshot.runs.empty() || snapshot.runs.back().first + snapshot.runs.back().second != i) {
+          snapshot.runs.push_back(std::make_pair(i, (size_t)0));
+        }
+        ++snapshot.runs.back().second;
+        snapshot.costs.push_back(slab[i]);
+      }
+    }
+  }
+  void restore(const snapshot_t &snapshot) {
+    std::fill(slab, slab + (size_t)num_columns * column_size, Cost::INFTY);
+    std::vector<Cost>::const_iterator cost = snapshot.costs.begin();
+    for(size_t r = 0; r < snapshot.runs.size(); ++r) {
+      std::copy(cost, cost + snapshot.runs[r].second, slab + snapshot.runs[r].first);
+      cost += snapshot.runs[r].second;
+    }
+  }
+
+private:
+
+  Counter num_columns;
+  std::vector<size_t> row_offsets;
+  size_t column_size;
+  size_t capacity;
+  Cost *slab;
+
+  PrevisionTable(const PrevisionTable&);
+  PrevisionTable& operator=(const PrevisionTable&);
+};
+
+#endif
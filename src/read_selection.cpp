@@ -0,0 +1,121 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#include "read_selection.h"
+
+#include <algorithm>
+
+
+//Order of the fragments in the greedy selection
+struct fragment_preference_t {
+  const std::vector<fragment_summary_t> &fragments;
+
+  fragment_preference_t(const std::vector<fragment_summary_t> &f)
+    : fragments(f)
+  {}
+
+  bool operator()(const size_t a, const size_t b) const {
+    if(fragments[a].num_entries != fragments[b].num_entries) {
+      return fragments[a].num_entries > fragments[b].num_entries;
+    }
+    if(fragments[a].total_phred != fragments[b].total_phred) {
+      return fragments[a].total_phred > fragments[b].total_phred;
+    }
+    return a < b;
+  }
+};
+
+
+
+//Range [first, last) of the indices in positions spanned by the fragment
+static
+void spanned_columns(const fragment_summary_t &fragment, const std::vector<Pointer> &positions,
+                     size_t &first, size_t &last)
+{
+  first = std::lower_bound(positions.begin(), positions.end(), fragment.first_position)
+    - positions.begin();
+  last = std::upper_bound(positions.begin() + first, positions.end(), fragment.last_position)
+    - positions.begin();
+}
+
+
+
+Counter select_fragments(const std::vector<fragment_summary_t> &fragments,
+                         const std::vector<Pointer> &positions,
+                         const Counter max_coverage,
+                         std::vector<bool> &selected)
+{
+  selected.assign(fragments.size(), true);
+
+  //Coverage of each column, as differences between consecutive columns
+  std::vector<int64_t> coverage(positions.size() + 1, 0);
+  size_t first = 0;
+  size_t last = 0;
+  for(size_t i = 0; i < fragments.size(); ++i) {
+    spanned_columns(fragments[i], positions, first, last);
+    ++coverage[first];
+    --coverage[last];
+  }
+  int64_t current = 0;
+  Counter max_current = 0;
+  for(size_t j = 0; j < positions.size(); ++j) {
+    current += coverage[j];
+    max_current = std::max(max_current, static_cast<Counter>(current));
+  }
+  if(max_current <= max_coverage) {
+    return 0;
+  }
+
+  std::vector<size_t> order(fragments.size());
+  for(size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), fragment_preference_t(fragments));
+
+  //The total length of the spans is the sum of the coverages of the
+  //columns, hence checking them one by one is linear in the block size
+  std::vector<Counter> selected_coverage(positions.size(), 0);
+  Counter discarded = 0;
+  for(std::vector<size_t>::const_iterator ifragment = order.begin();
+      ifragment != order.end();
+      ++ifragment) {
+    spanned_columns(fragments[*ifragment], positions, first, last);
+    bool fits = true;
+    for(size_t j = first; fits && j < last; ++j) {
+      fits = (selected_coverage[j] < max_coverage);
+    }
+    if(fits) {
+      for(size_t j = first; j < last; ++j) {
+        ++selected_coverage[j];
+      }
+    } else {
+      selected[*ifragment] = false;
+      ++discarded;
+    }
+  }
+
+  return discarded;
+}
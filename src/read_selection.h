@@ -0,0 +1,75 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#ifndef READ_SELECTION_H
+#define READ_SELECTION_H
+
+#include <vector>
+#include <stdint.h>
+
+#include "basic_types.h"
+
+
+//What the read selection needs to know of a fragment
+struct fragment_summary_t {
+  Pointer first_position;
+  Pointer last_position;
+  Counter num_entries;
+  uint64_t total_phred;
+
+  //The entries of the fragment (not empty) are in [begin, end)
+  fragment_summary_t(Fragment::const_iterator begin, Fragment::const_iterator end)
+  {
+    first_position = (*begin).position;
+    last_position = (*(end - 1)).position;
+    num_entries = end - begin;
+    total_phred = 0;
+    for(Fragment::const_iterator ientry = begin;
+        ientry != end;
+        ++ientry) {
+      total_phred += (*ientry).phred_score;
+    }
+  }
+};
+
+
+//Choose the fragments to keep so that every position of positions (sorted,
+//without duplicates, including all the positions of the fragments) is
+//spanned by at most max_coverage selected fragments. A fragment spans all
+//the positions from its first to its last one, as it gives an entry (possibly
+//a gap) to all their columns.
+//If the coverage is already within max_coverage, all the fragments are kept.
+//Otherwise the fragments are considered greedily from the ones with more
+//entries (then with the higher total phred score, then in input order) and
+//each one is kept if it fits under max_coverage.
+//Set selected[i] to true if the i-th fragment is kept and return the number
+//of the discarded fragments.
+Counter select_fragments(const std::vector<fragment_summary_t> &fragments,
+                         const std::vector<Pointer> &positions,
+                         const Counter max_coverage,
+                         std::vector<bool> &selected);
+
+#endif
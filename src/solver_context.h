@@ -0,0 +1,147 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#ifndef SOLVER_CONTEXT_H
+#define SOLVER_CONTEXT_H
+
+#include <bitset>
+#include <vector>
+#include <memory>
+
+#include "basic_types.h"
+#include "prevision_table.h"
+#include "backtrace_table.h"
+#include "mask_projection.h"
+#include "mask_batch.h"
+#include "mask_range.h"
+#include "worker_pool.h"
+
+//Working memory of the DP, kept from a block to the following ones. The
+//buffers are resized for each block, but their memory only grows: after the
+//largest blocks have been solved, the DP of a block allocates nothing.
+class SolverContext {
+
+public:
+
+  //Parameters of the block
+  std::vector<Counter> sum_successive_L;
+  std::vector<std::vector<Counter> > scheme_backtrace;
+  std::vector<Column> window;
+
+  //Window of the DP
+  std::vector<Column> input;
+  std::vector<std::vector<Pointer> > back_indexer;
+  std::vector<std::vector<Pointer> > forw_indexer;
+  std::vector<Counter> num_pos_gaps;
+  std::vector<Counter> k_j;
+  std::vector<Counter> homo_cost;
+  std::vector<Cost> homo_weight;
+  std::vector<Cost> OPT;
+  std::vector<Counter> no_gap_reads;
+  std::vector<Counter> gap_reads;
+  std::vector<Cost> min_weight;
+  PrevisionTable prevision;
+  BacktraceTable backtrace;
+  MaskBatch batch;
+
+  //Threads of the DP (if more than one is used) and the ranges of the masks
+  //of a column that they evaluate
+  std::unique_ptr<WorkerPool> pool;
+
+  //Optimal choices of each column of the block
+  std::vector<bool> is_homozygous;
+  std::vector<bool> homo_haplotypes;
+  std::vector<Backtrace1> best_heterozygous1;
+  std::vector<bool> best_heterozygous2_haplotypes;
+  std::vector<bool> best_heterozygous2_new_block;
+
+  //Buffers of the width of the bit columns of the block
+  template <typename BitColumn>
+  struct bit_buffers_t {
+    std::vector<BitColumn> pos_gaps;
+    std::vector<MaskProjection<BitColumn> > projections;
+    std::vector<MaskRange<BitColumn> > ranges;
+  };
+  template <typename BitColumn>
+  bit_buffers_t<BitColumn>& bit_buffers();
+
+  //Set rows to size rows of row_size values, keeping their memory
+  template <typename T>
+  void reset(std::vector<std::vector<T> > &rows, const size_t &size,
+             const size_t &row_size, const T &value) {
+    resize(rows, size);
+    for(size_t i = 0; i < size; ++i) {
+      rows[i].assign(row_size, value);
+    }
+  }
+
+  //Set rows to size rows: the rows dropped are kept aside (with their
+  //memory) and they are used again when the rows grow
+  template <typename T>
+  void resize(std::vector<std::vector<T> > &rows, const size_t &size) {
+    std::vector<std::vector<T> > &spare = spare_rows((T*)NULL);
+    while(rows.size() > size) {
+      spare.push_back(std::vector<T>());
+      spare.back().swap(rows.back());
+      rows.pop_back();
+    }
+    while(rows.size() < size) {
+      rows.push_back(std::vector<T>());
+      if(!spare.empty()) {
+        rows.back().swap(spare.back());
+        spare.pop_back();
+      }
+    }
+  }
+
+private:
+
+  std::vector<Column> spare_columns;
+  std::vector<std::vector<Pointer> > spare_pointers;
+  std::vector<std::vector<Counter> > spare_counters;
+
+  std::vector<Column>& spare_rows(Entry*) { return spare_columns; }
+  std::vector<std::vector<Pointer> >& spare_rows(Pointer*) { return spare_pointers; }
+  std::vector<std::vector<Counter> >& spare_rows(Counter*) { return spare_counters; }
+
+  bit_buffers_t<std::bitset<32> > bits32;
+  bit_buffers_t<std::bitset<64> > bits64;
+  bit_buffers_t<std::bitset<MAX_COVERAGE> > bits_max;
+};
+
+template <>
+inline SolverContext::bit_buffers_t<std::bitset<32> >&
+SolverContext::bit_buffers<std::bitset<32> >() { return bits32; }
+
+template <>
+inline SolverContext::bit_buffers_t<std::bitset<64> >&
+SolverContext::bit_buffers<std::bitset<64> >() { return bits64; }
+
+template <>
+inline SolverContext::bit_buffers_t<std::bitset<MAX_COVERAGE> >&
+SolverContext::bit_buffers<std::bitset<MAX_COVERAGE> >() { return bits_max; }
+
+#endif
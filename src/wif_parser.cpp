@@ -0,0 +1,296 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#include "wif_parser.h"
+
+#include <string.h>
+#include <iostream>
+#include <cstdlib>
+
+
+//Character classes used by the WIF tokenizer (same as the ones skipped by
+//operator>> in the default locale, newlines excluded)
+static inline
+bool is_blank(const char c)
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static inline
+const char* skip_blanks(const char *p, const char *end)
+{
+  while(p < end && is_blank(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+static inline
+const char* token_end(const char *p, const char *end)
+{
+  while(p < end && !is_blank(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+//Same semantics of atoi on the token [p, end)
+static inline
+int token_to_int(const char *p, const char *end)
+{
+  bool negative = false;
+  if(p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    ++p;
+  }
+  int value = 0;
+  while(p < end && *p >= '0' && *p <= '9') {
+    value = value * 10 + (*p - '0');
+    ++p;
+  }
+  return negative ? -value : value;
+}
+
+
+
+const char* next_wif_line(const char *&begin, const char *limit, const char *&line_end)
+{
+  while(begin < limit) {
+    const char *eol = static_cast<const char*>(memchr(begin, '\n', limit - begin));
+    if(eol == NULL) {
+      eol = limit;
+    }
+
+    const char *line = begin;
+    begin = (eol < limit) ? eol + 1 : limit;
+
+    //Empty lines are skipped
+    if(eol != line) {
+      line_end = eol;
+      return line;
+    }
+  }
+
+  return NULL;
+}
+
+
+
+//It reports the same errors of BlockReader::string_to_fragment, without
+//building any temporary string. It is stricter on an entry without a phred
+//score (such as "100 A 0 :"): string_to_fragment takes the allele as its
+//score, while it is not well formatted here.
+const char* parse_wif_line(const char *begin, const char *end,
+                           const bool unweighted, Fragment &read)
+{
+  static const char *NOT_WELL_FORMATTED = "ERROR: wif input file not well formatted!";
+
+  read.clear();
+
+  const char *p = begin;
+  while(true) {
+    //Every entry (the comment one included) must be terminated by ':'
+    const char *sep = static_cast<const char*>(memchr(p, ':', end - p));
+    if(sep == NULL) {
+      return NOT_WELL_FORMATTED;
+    }
+
+    const char *token = skip_blanks(p, sep);
+    const char *token_stop = token_end(token, sep);
+    if(token == sep) {
+      return NOT_WELL_FORMATTED;
+    }
+
+    if(token_stop - token == 1 && *token == '#') {
+      if(read.empty()) {
+        return "ERROR: empty read are not allowed in the input wif";
+      }
+      return NULL;
+    }
+
+    const int position = token_to_int(token, token_stop);
+
+    //Skip the nucleotide
+    token = skip_blanks(token_stop, sep);
+    token_stop = token_end(token, sep);
+
+    token = skip_blanks(token_stop, sep);
+    token_stop = token_end(token, sep);
+    if(token_stop - token != 1 || (*token != '0' && *token != '1')) {
+      return "ERROR: found an entry in wif file with an allele not 0 or 1";
+    }
+    const bool allele = (*token == '1');
+
+    token = skip_blanks(token_stop, sep);
+    token_stop = token_end(token, sep);
+    if(token == token_stop) {
+      return NOT_WELL_FORMATTED;
+    }
+    const unsigned int phred = (unweighted) ? 1 : token_to_int(token, token_stop);
+
+    read.push_back(EntryRead(position, allele, phred));
+
+    p = sep + 1;
+  }
+}
+
+
+
+ChunkedWifParser::ChunkedWifParser(const char *data, const size_t size, const size_t start,
+                                   const unsigned int num_threads, const bool unweighted)
+  : data(data), next_start(data + start), limit(data + size), unweighted(unweighted),
+    slots(2 * num_threads), dispatched(0), consumed(0),
+    all_dispatched(start >= size), stopping(false),
+    current(NULL), next_in_chunk(0)
+{
+  for(size_t i = 0; i < slots.size(); ++i) {
+    slots[i].ready = false;
+  }
+  for(unsigned int i = 0; i < num_threads; ++i) {
+    workers.push_back(std::thread(&ChunkedWifParser::worker, this));
+  }
+}
+
+
+
+ChunkedWifParser::~ChunkedWifParser()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  slot_freed.notify_all();
+  for(size_t i = 0; i < workers.size(); ++i) {
+    workers[i].join();
+  }
+}
+
+
+
+void ChunkedWifParser::worker()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while(true) {
+    //A chunk can be parsed only when its slot has been released
+    while(!stopping && !all_dispatched && dispatched >= consumed + slots.size()) {
+      slot_freed.wait(lock);
+    }
+    if(stopping || all_dispatched) {
+      return;
+    }
+
+    //The chunk ends with the first newline after CHUNK_SIZE bytes
+    const size_t index = dispatched++;
+    const char *begin = next_start;
+    const char *end = limit;
+    if(static_cast<size_t>(limit - begin) > CHUNK_SIZE) {
+      const char *eol = static_cast<const char*>(memchr(begin + CHUNK_SIZE, '\n',
+                                                        limit - begin - CHUNK_SIZE));
+      if(eol != NULL) {
+        end = eol + 1;
+      }
+    }
+    next_start = end;
+    if(next_start >= limit) {
+      all_dispatched = true;
+      //The idle workers have nothing left to do
+      slot_freed.notify_all();
+    }
+
+    chunk_t &chunk = slots[index % slots.size()];
+    lock.unlock();
+    parse_chunk(data, begin, end, unweighted, chunk);
+    lock.lock();
+
+    chunk.index = index;
+    chunk.ready = true;
+    chunk_parsed.notify_all();
+  }
+}
+
+
+
+void ChunkedWifParser::parse_chunk(const char *data, const char *begin, const char *end,
+                                   const bool unweighted, chunk_t &chunk)
+{
+  chunk.entries.clear();
+  chunk.offsets.assign(1, 0);
+  chunk.line_offsets.clear();
+  chunk.error = NULL;
+
+  Fragment read;
+  const char *line_end = NULL;
+  const char *line = NULL;
+  while((line = next_wif_line(begin, end, line_end)) != NULL) {
+    chunk.error = parse_wif_line(line, line_end, unweighted, read);
+    if(chunk.error != NULL) {
+      //The following lines will never be read
+      return;
+    }
+    chunk.entries.insert(chunk.entries.end(), read.begin(), read.end());
+    chunk.offsets.push_back(chunk.entries.size());
+    chunk.line_offsets.push_back(line - data);
+  }
+}
+
+
+
+bool ChunkedWifParser::next_fragment(Fragment &read, size_t &offset)
+{
+  while(true) {
+    if(current != NULL) {
+      if(next_in_chunk + 1 < current->offsets.size()) {
+        read.assign(current->entries.begin() + current->offsets[next_in_chunk],
+                    current->entries.begin() + current->offsets[next_in_chunk + 1]);
+        offset = current->line_offsets[next_in_chunk];
+        ++next_in_chunk;
+        return true;
+      }
+      if(current->error != NULL) {
+        std::cerr << current->error << std::endl;
+        exit(EXIT_FAILURE);
+      }
+
+      //Release the slot of the chunk
+      std::lock_guard<std::mutex> lock(mutex);
+      current->ready = false;
+      current = NULL;
+      ++consumed;
+      slot_freed.notify_all();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    chunk_t &chunk = slots[consumed % slots.size()];
+    while(!(chunk.ready && chunk.index == consumed)) {
+      if(all_dispatched && consumed >= dispatched) {
+        return false;
+      }
+      chunk_parsed.wait(lock);
+    }
+    current = &chunk;
+    next_in_chunk = 0;
+  }
+}
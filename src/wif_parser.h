@@ -0,0 +1,118 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#ifndef WIF_PARSER_H
+#define WIF_PARSER_H
+
+#include <vector>
+#include <cstddef>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "basic_types.h"
+
+
+//Return the first line of [begin, limit) that is not empty, setting
+//line_end to its end (excluded) and begin to the start of the following line.
+//Return NULL if there are no more lines.
+const char* next_wif_line(const char *&begin, const char *limit, const char *&line_end);
+
+//Tokenize the WIF line [begin, end) in place into read.
+//Return NULL on success, otherwise the error message to be reported.
+const char* parse_wif_line(const char *begin, const char *end,
+                           const bool unweighted, Fragment &read);
+
+
+//Parse a (textual) WIF file already in memory with a pool of threads.
+//The input is split at line boundaries into chunks that are parsed
+//concurrently, while the fragments are returned in file order by
+//next_fragment. At most a fixed number of chunks (proportional to the
+//number of threads) are kept in memory at the same time.
+class ChunkedWifParser {
+
+public:
+
+  //The parsing starts at data + start
+  ChunkedWifParser(const char *data, const size_t size, const size_t start,
+                   const unsigned int num_threads, const bool unweighted);
+  ~ChunkedWifParser();
+
+  //Get the next fragment of the input. Return false if there are no more
+  //fragments. Malformed lines are reported (and the program exits) when the
+  //fragments preceding them have been returned, as in a sequential parsing.
+  //The offset of the line of the fragment (from data) is stored in offset.
+  bool next_fragment(Fragment &read, size_t &offset);
+
+  //Size of the chunks the input is split into
+  static const size_t CHUNK_SIZE = 1 << 22;
+
+private:
+
+  struct chunk_t {
+    size_t index;
+    bool ready;
+    std::vector<EntryRead> entries;
+    //The entries of the i-th fragment are in [offsets[i], offsets[i + 1])
+    std::vector<size_t> offsets;
+    //Offset (from data) of the line of each fragment
+    std::vector<size_t> line_offsets;
+    //Error found after the last fragment of the chunk (NULL if none)
+    const char *error;
+  };
+
+  const char *data;
+  const char *next_start;
+  const char *limit;
+  bool unweighted;
+
+  std::vector<chunk_t> slots;
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable chunk_parsed;
+  std::condition_variable slot_freed;
+
+  //Chunks handed to the workers, consumed chunks, total number of chunks
+  //(known only when the whole input has been handed to the workers)
+  size_t dispatched;
+  size_t consumed;
+  bool all_dispatched;
+  bool stopping;
+
+  //Chunk currently read by next_fragment
+  chunk_t *current;
+  size_t next_in_chunk;
+
+  void worker();
+  static void parse_chunk(const char *data, const char *begin, const char *end,
+                          const bool unweighted, chunk_t &chunk);
+
+  //Not copyable: the workers refer to this object
+  ChunkedWifParser(const ChunkedWifParser&);
+  ChunkedWifParser& operator=(const ChunkedWifParser&);
+};
+
+#endif
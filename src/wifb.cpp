@@ -0,0 +1,277 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#include "wifb.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+#include <iostream>
+
+#include "blockreader.h"
+
+
+static inline
+uint64_t align8(const uint64_t size)
+{
+  return (size + 7) & ~((uint64_t)7);
+}
+
+
+//Offsets (from the beginning of the file) of the arrays of a binary WIF
+struct wifb_layout_t {
+  uint64_t fragment_offsets;
+  uint64_t block_fragments;
+  uint64_t block_position_offsets;
+  uint64_t positions;
+  uint64_t block_positions;
+  uint64_t phred_scores;
+  uint64_t alleles;
+  uint64_t total_size;
+
+  wifb_layout_t(const wifb_header_t &h) {
+    fragment_offsets = align8(sizeof(wifb_header_t));
+    block_fragments = fragment_offsets + 8 * (h.num_fragments + 1);
+    block_position_offsets = block_fragments + 8 * (h.num_blocks + 1);
+    positions = block_position_offsets + 8 * (h.num_blocks + 1);
+    block_positions = align8(positions + 4 * h.num_entries);
+    phred_scores = align8(block_positions + 4 * h.num_block_positions);
+    alleles = align8(phred_scores + h.num_entries);
+    total_size = alleles + (h.num_entries + 7) / 8;
+  }
+};
+
+
+
+bool WifbFile::has_magic(const char *data, const size_t size)
+{
+  return size >= WIFB_MAGIC_LENGTH && memcmp(data, WIFB_MAGIC, WIFB_MAGIC_LENGTH) == 0;
+}
+
+
+
+bool WifbFile::attach(const char *data, const size_t size, std::string &error)
+{
+  if(size < sizeof(wifb_header_t) || !has_magic(data, size)) {
+    error = "missing header";
+    return false;
+  }
+  header = reinterpret_cast<const wifb_header_t*>(data);
+  if(header->version != WIFB_VERSION || header->header_size != sizeof(wifb_header_t)) {
+    error = "unsupported version (the file must be converted again)";
+    return false;
+  }
+
+  const wifb_layout_t layout(*header);
+  if(layout.total_size != size) {
+    error = "unexpected file size";
+    return false;
+  }
+
+  fragment_offsets = reinterpret_cast<const uint64_t*>(data + layout.fragment_offsets);
+  block_fragments = reinterpret_cast<const uint64_t*>(data + layout.block_fragments);
+  block_position_offsets = reinterpret_cast<const uint64_t*>(data + layout.block_position_offsets);
+  positions = reinterpret_cast<const int32_t*>(data + layout.positions);
+  block_positions = reinterpret_cast<const int32_t*>(data + layout.block_positions);
+  phred_scores = reinterpret_cast<const uint8_t*>(data + layout.phred_scores);
+  alleles = reinterpret_cast<const uint8_t*>(data + layout.alleles);
+
+  //The tables are used to address the other arrays
+  if(fragment_offsets[header->num_fragments] != header->num_entries ||
+     block_fragments[header->num_blocks] != header->num_fragments ||
+     block_position_offsets[header->num_blocks] != header->num_block_positions) {
+    error = "inconsistent tables";
+    return false;
+  }
+
+  return true;
+}
+
+
+
+//Buffered sequential writer of an array of the binary file (starting at
+//a given offset)
+class SectionWriter {
+
+public:
+
+  SectionWriter(const int f, const uint64_t o)
+    : fd(f), offset(o)
+  {
+    buffer.reserve(BUFFER_SIZE);
+  }
+
+  ~SectionWriter() { flush(); }
+
+  void write(const void *data, const size_t size) {
+    const char *bytes = static_cast<const char*>(data);
+    buffer.insert(buffer.end(), bytes, bytes + size);
+    if(buffer.size() >= BUFFER_SIZE) {
+      flush();
+    }
+  }
+
+  void flush() {
+    size_t written = 0;
+    while(written < buffer.size()) {
+      const ssize_t w = pwrite(fd, &buffer[written], buffer.size() - written, offset);
+      if(w <= 0) {
+        std::cerr << "ERROR: failing writing the binary wif file" << std::endl;
+        exit(EXIT_FAILURE);
+      }
+      written += w;
+      offset += w;
+    }
+    buffer.clear();
+  }
+
+private:
+
+  static const size_t BUFFER_SIZE = 1 << 20;
+
+  int fd;
+  uint64_t offset;
+  std::vector<char> buffer;
+};
+
+
+
+void convert_to_wifb(BlockReader &reader, const std::string &output_filename)
+{
+  if(reader.is_binary()) {
+    std::cerr << "ERROR: the input file is already a binary wif file" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  wifb_header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, WIFB_MAGIC, WIFB_MAGIC_LENGTH);
+  header.version = WIFB_VERSION;
+  header.header_size = sizeof(wifb_header_t);
+
+  //First pass: compute the size of the arrays
+  {
+    while(reader.has_next()) {
+      if(reader.get_fragment_offsets().size() > 1) {
+        header.num_fragments += reader.get_fragment_offsets().size() - 1;
+        header.num_entries += reader.get_fragment_entries().size();
+        header.num_block_positions += reader.get_block_positions().size();
+        ++header.num_blocks;
+      }
+    }
+  }
+
+  const wifb_layout_t layout(header);
+
+  const int fd = open(output_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(fd < 0 || ftruncate(fd, layout.total_size) != 0) {
+    std::cerr << "ERROR: failing opening the output file: " << output_filename << std::endl;
+    exit(EXIT_FAILURE);
+  }
+
+  //Second pass: fill the arrays
+  {
+    SectionWriter header_writer(fd, 0);
+    SectionWriter fragment_offsets(fd, layout.fragment_offsets);
+    SectionWriter block_fragments(fd, layout.block_fragments);
+    SectionWriter block_position_offsets(fd, layout.block_position_offsets);
+    SectionWriter positions(fd, layout.positions);
+    SectionWriter block_positions(fd, layout.block_positions);
+    SectionWriter phred_scores(fd, layout.phred_scores);
+    SectionWriter alleles(fd, layout.alleles);
+
+    header_writer.write(&header, sizeof(header));
+
+    uint64_t num_fragments = 0;
+    uint64_t num_entries = 0;
+    uint64_t num_block_positions = 0;
+    uint8_t allele_byte = 0;
+
+    reader.seek_block(0);
+    while(reader.has_next()) {
+      const std::vector<EntryRead> &entries = reader.get_fragment_entries();
+      const std::vector<size_t> &offsets = reader.get_fragment_offsets();
+      const std::vector<Pointer> &positions_block = reader.get_block_positions();
+
+      if(offsets.size() == 1) {
+        continue;
+      }
+
+      block_fragments.write(&num_fragments, 8);
+      block_position_offsets.write(&num_block_positions, 8);
+
+      for(size_t i = 0; i + 1 < offsets.size(); ++i) {
+        const uint64_t offset = num_entries + offsets[i];
+        fragment_offsets.write(&offset, 8);
+      }
+
+      for(std::vector<EntryRead>::const_iterator ientry = entries.begin();
+          ientry != entries.end();
+          ++ientry) {
+        if((*ientry).phred_score > 255) {
+          std::cerr << "ERROR: phred score " << (*ientry).phred_score
+                    << " cannot be stored in a binary wif file" << std::endl;
+          exit(EXIT_FAILURE);
+        }
+        const int32_t position = (*ientry).position;
+        const uint8_t phred = (*ientry).phred_score;
+        positions.write(&position, 4);
+        phred_scores.write(&phred, 1);
+
+        allele_byte |= ((*ientry).allele ? 1 : 0) << (num_entries & 7);
+        ++num_entries;
+        if((num_entries & 7) == 0) {
+          alleles.write(&allele_byte, 1);
+          allele_byte = 0;
+        }
+      }
+
+      for(std::vector<Pointer>::const_iterator ipos = positions_block.begin();
+          ipos != positions_block.end();
+          ++ipos) {
+        const int32_t position = *ipos;
+        block_positions.write(&position, 4);
+      }
+
+      num_fragments += offsets.size() - 1;
+      num_block_positions += positions_block.size();
+    }
+
+    if((num_entries & 7) != 0) {
+      alleles.write(&allele_byte, 1);
+    }
+    fragment_offsets.write(&num_entries, 8);
+    block_fragments.write(&num_fragments, 8);
+    block_position_offsets.write(&num_block_positions, 8);
+  }
+
+  if(close(fd) != 0) {
+    std::cerr << "ERROR: failing writing the binary wif file" << std::endl;
+    exit(EXIT_FAILURE);
+  }
+}
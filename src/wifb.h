@@ -0,0 +1,114 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#ifndef WIFB_H
+#define WIFB_H
+
+#include <stdint.h>
+#include <string>
+
+
+//Binary (pre-indexed) version of a WIF file.
+//
+//The file starts with a wifb_header_t and continues with the following
+//arrays, in this order, each one starting at a multiple of 8 bytes
+//(all the values are stored in the byte order of the host that wrote them):
+//
+//  uint64_t fragment_offsets[num_fragments + 1]   first entry of each fragment
+//  uint64_t block_fragments[num_blocks + 1]       first fragment of each block
+//  uint64_t block_position_offsets[num_blocks + 1] first position of each block
+//  int32_t  positions[num_entries]                position of each entry
+//  int32_t  block_positions[num_block_positions]  sorted positions of each block
+//  uint8_t  phred_scores[num_entries]             phred score of each entry
+//  uint8_t  alleles[(num_entries + 7) / 8]        allele of each entry (1 bit)
+//
+//Blocks are the independent blocks found on the WIF file when it is not read
+//as a unique block. Phred scores are stored as they are in the WIF file (the
+//--discard-weights option is applied while loading).
+
+#define WIFB_MAGIC "HAPCOLWB"
+#define WIFB_MAGIC_LENGTH 8
+#define WIFB_VERSION 1
+
+struct wifb_header_t {
+  char magic[WIFB_MAGIC_LENGTH];
+  uint32_t version;
+  uint32_t header_size;
+  uint64_t num_fragments;
+  uint64_t num_entries;
+  uint64_t num_blocks;
+  uint64_t num_block_positions;
+};
+
+
+//Read-only view of a binary WIF file already in memory
+class WifbFile {
+
+public:
+
+  WifbFile()
+    : fragment_offsets(NULL), block_fragments(NULL),
+      block_position_offsets(NULL), positions(NULL), block_positions(NULL),
+      phred_scores(NULL), alleles(NULL), header(NULL)
+  {}
+
+  //Return true if the data starts with the binary WIF magic bytes
+  static bool has_magic(const char *data, const size_t size);
+
+  //Check the header and the size of the data, then set up the arrays.
+  //Return false (and set error) if the data is not a valid binary WIF.
+  bool attach(const char *data, const size_t size, std::string &error);
+
+  uint64_t num_fragments() const { return header->num_fragments; }
+  uint64_t num_entries() const { return header->num_entries; }
+  uint64_t num_blocks() const { return header->num_blocks; }
+
+  const uint64_t *fragment_offsets;
+  const uint64_t *block_fragments;
+  const uint64_t *block_position_offsets;
+  const int32_t *positions;
+  const int32_t *block_positions;
+  const uint8_t *phred_scores;
+  const uint8_t *alleles;
+
+  bool allele(const uint64_t entry) const {
+    return (alleles[entry >> 3] >> (entry & 7)) & 1;
+  }
+
+private:
+
+  const wifb_header_t *header;
+};
+
+
+class BlockReader;
+
+//Write the fragments read by reader (from a textual WIF file or from a set of
+//fragments) into a binary WIF file. The reader must read the fragments with
+//their weights, without any coverage threshold and not as a unique block.
+void convert_to_wifb(BlockReader &reader, const std::string &output_filename);
+
+#endif
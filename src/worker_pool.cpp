@@ -0,0 +1,94 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#include "worker_pool.h"
+
+WorkerPool::WorkerPool(const unsigned int num_threads)
+  : task(NULL), generation(0), running(0), stopping(false)
+{
+  for(unsigned int part = 1; part < num_threads; ++part) {
+    workers.push_back(std::thread(&WorkerPool::worker, this, part));
+  }
+}
+
+
+
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  task_started.notify_all();
+  for(size_t i = 0; i < workers.size(); ++i) {
+    workers[i].join();
+  }
+}
+
+
+
+void WorkerPool::run(task_t &task)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->task = &task;
+    running = workers.size();
+    ++generation;
+  }
+  task_started.notify_all();
+
+  task.run(0);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while(running > 0) {
+    part_completed.wait(lock);
+  }
+  this->task = NULL;
+}
+
+
+
+void WorkerPool::worker(const unsigned int part)
+{
+  unsigned long long done = 0;
+  std::unique_lock<std::mutex> lock(mutex);
+  while(true) {
+    while(!stopping && generation == done) {
+      task_started.wait(lock);
+    }
+    if(stopping) {
+      return;
+    }
+    done = generation;
+    task_t &current = *task;
+    lock.unlock();
+    current.run(part);
+    lock.lock();
+    if(--running == 0) {
+      part_completed.notify_one();
+    }
+  }
+}
@@ -0,0 +1,78 @@
+/**
+ *
+ *                              HapCol
+ * Fast and Memory-efficient Haplotype Assembly From Gapless Long Reads
+ *
+ * Copyright (C) 2015  Yuri Pirola, Simone Zaccaria
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ *
+ * This file is part of HapCol.
+ *
+ * HapCol is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * HapCol is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with HapCol.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ **/
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//A pool of threads that run the parts of a task together with the thread
+//that submits it. The threads are kept (waiting) between the tasks, so that
+//a task can be as short as a single step of the DP.
+class WorkerPool {
+
+public:
+
+  //A task split into parts: run(i) is called once for each part i
+  struct task_t {
+    virtual void run(const unsigned int part) = 0;
+    virtual ~task_t() {}
+  };
+
+  //A pool of num_threads threads in all, including the calling one
+  explicit WorkerPool(const unsigned int num_threads);
+  ~WorkerPool();
+
+  unsigned int size() const { return workers.size() + 1; }
+
+  //Run the parts 0, ..., size() - 1 of task (part 0 on the calling thread)
+  //and return when all of them have been completed
+  void run(task_t &task);
+
+private:
+
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable task_started;
+  std::condition_variable part_completed;
+
+  task_t *task;
+  //Number of tasks submitted, and parts of the current one still running
+  unsigned long long generation;
+  unsigned int running;
+  bool stopping;
+
+  void worker(const unsigned int part);
+
+  //Not copyable: the workers refer to this object
+  WorkerPool(const WorkerPool&);
+  WorkerPool& operator=(const WorkerPool&);
+};
+
+#endif